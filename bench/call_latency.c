@@ -0,0 +1,124 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+/**
+ * Compares the latency of calling a col function through libcol with
+ * the latency of running the same program by fork+exec of colint.
+ *
+ * Usage: call_latency <path to colint> [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "col.h"
+
+#define DEFAULT_ITERATIONS 1000
+
+static const char *PROGRAM =
+    "main = compose{ str, *, construct{ id, const(3) }, int, head }\n";
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Times repeated calls to main through the library
+double time_library(int iterations)
+{
+    int i;
+    double start;
+    struct col_program *program = col_program_load(PROGRAM, strlen(PROGRAM));
+    struct col_function *f = col_program_find(program, "main");
+    struct col_value *args = NULL;
+
+    start = now();
+    for(i = 0; i < iterations; i++)
+    {
+        args = col_value_seq();
+        col_seq_push(args, col_value_string("14"));
+        col_value_delete(col_call(f, args));
+    }
+
+    col_program_delete(program);
+    return (now() - start) / iterations;
+}
+
+// Times repeated fork+exec of colint on the same program
+double time_process(const char *colint, int iterations)
+{
+    int i;
+    int fd;
+    double start;
+    pid_t pid;
+    char path[] = "/tmp/col-bench-XXXXXX";
+
+    fd = mkstemp(path);
+    if(fd < 0 || write(fd, PROGRAM, strlen(PROGRAM)) < 0)
+        return -1;
+    close(fd);
+
+    start = now();
+    for(i = 0; i < iterations; i++)
+    {
+        pid = fork();
+        if(pid == 0)
+        {
+            fd = open("/dev/null", O_WRONLY);
+            dup2(fd, STDOUT_FILENO);
+            execl(colint, colint, path, "14", (char*)NULL);
+            _exit(127);
+        }
+        waitpid(pid, NULL, 0);
+    }
+
+    unlink(path);
+    return (now() - start) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = DEFAULT_ITERATIONS;
+    double library, process;
+
+    if(argc < 2)
+    {
+        printf("Usage: call_latency <path to colint> [iterations]\n");
+        return 1;
+    }
+
+    if(argc > 2)
+        iterations = atoi(argv[2]);
+
+    library = time_library(iterations);
+    process = time_process(argv[1], iterations);
+
+    printf("libcol call:      %10.3f us\n", library * 1e6);
+    printf("fork+exec colint: %10.3f us\n", process * 1e6);
+    printf("speedup:          %10.1fx\n", process / library);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+/**
+ * Measures how quickly a large machine-generated source is loaded, which
+ * is dominated by the lexer.
+ *
+ * Usage: lex_throughput [megabytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "col.h"
+
+#define DEFAULT_MEGABYTES 32
+
+// One generated definition, with the indentation and comments typical of
+// generated code
+static const char *DEFINITION =
+    "# Generated definition %d\n"
+    "f%d =\n"
+    "        compose{\n"
+    "                concat,\n"
+    "                construct{ const(\"generated string %d\"),\n"
+    "                           const(<%d, 2.5, 'x', true>) },\n"
+    "                id\n"
+    "        }\n\n";
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t target = (size_t)DEFAULT_MEGABYTES << 20;
+    size_t length = 0;
+    size_t size;
+    char *source = NULL;
+    int i;
+    double start, elapsed;
+    struct col_program *program = NULL;
+
+    if(argc > 1)
+        target = (size_t)atoi(argv[1]) << 20;
+
+    size = target + 1024;
+    source = (char*)malloc(size);
+    for(i = 0; length < target; i++)
+        length += snprintf(source + length, size - length, DEFINITION,
+                           i, i, i, i);
+
+    start = now();
+    program = col_program_load(source, length);
+    elapsed = now() - start;
+
+    if(!program)
+    {
+        printf("Error: Generated source failed to load\n");
+        return 1;
+    }
+
+    printf("definitions: %10d\n", i);
+    printf("load time:   %10.3f s\n", elapsed);
+    printf("throughput:  %10.1f MB/s\n", length / elapsed / (1 << 20));
+
+    col_program_delete(program);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+/**
+ * Compares a join done by looking each key up in a map with the same join
+ * done by scanning the table of pairs with eq for every key.
+ *
+ * Usage: map_join [rows] [probes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "col.h"
+
+#define DEFAULT_ROWS 10000
+#define DEFAULT_PROBES 100
+
+static const char *PROGRAM =
+    "hashed = compose{ map{ mapget }, distl,\n"
+    "                  construct{ compose{ mapfromseq, head },\n"
+    "                             compose{ head, tail } } }\n"
+    "match = compose{ eq, construct{ compose{ head, head },\n"
+    "                                compose{ head, tail } } }\n"
+    "scanned = compose{ map{ compose{ head, tail, head, head, filter{ match },\n"
+    "                                 distr } },\n"
+    "                   distl }\n";
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Builds the input for one call, a table of pairs < k, 2k > and a sequence
+// of keys spread evenly across it
+struct col_value *input(int rows, int probes)
+{
+    int i;
+    struct col_value *in = col_value_seq();
+    struct col_value *table = col_value_seq();
+    struct col_value *keys = col_value_seq();
+    struct col_value *pair = NULL;
+
+    for(i = 0; i < rows; i++)
+    {
+        pair = col_value_seq();
+        col_seq_push(pair, col_value_int(i));
+        col_seq_push(pair, col_value_int(2 * i));
+        col_seq_push(table, pair);
+    }
+
+    for(i = 0; i < probes; i++)
+        col_seq_push(keys, col_value_int((int)((long)i * rows / probes)));
+
+    col_seq_push(in, table);
+    col_seq_push(in, keys);
+    return in;
+}
+
+// Times a single join, building the input outside of the timed region,
+// and prints the time per key looked up
+double time_function(struct col_program *program, const char *name,
+                     int rows, int probes)
+{
+    double start, total;
+    struct col_function *f = col_program_find(program, name);
+    struct col_value *in = input(rows, probes);
+    struct col_value *out = NULL;
+
+    start = now();
+    out = col_call(f, in);
+    total = now() - start;
+
+    if(col_value_type(out) != COL_SEQ || col_seq_length(out) != probes
+       || col_value_get_int(col_seq_get(out, probes - 1))
+          != 2 * (int)((long)(probes - 1) * rows / probes))
+    {
+        printf("%s returned the wrong result\n", name);
+        exit(1);
+    }
+    col_value_delete(out);
+
+    total /= probes;
+    printf("%-8s %12.2f us/key\n", name, total * 1e6);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    int rows = DEFAULT_ROWS;
+    int probes = DEFAULT_PROBES;
+    double hashed, scanned;
+    struct col_program *program = NULL;
+
+    if(argc > 1)
+        rows = atoi(argv[1]);
+    if(argc > 2)
+        probes = atoi(argv[2]);
+
+    program = col_program_load(PROGRAM, strlen(PROGRAM));
+
+    hashed = time_function(program, "hashed", rows, probes);
+    scanned = time_function(program, "scanned", rows, probes);
+    printf("speedup:  %12.1fx\n", scanned / hashed);
+
+    col_program_delete(program);
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+/**
+ * Measures how quickly println writes lines.  Lines go to standard output,
+ * which should be redirected, and the timing to standard error.
+ *
+ * Usage: print_throughput [lines] [line|block|exit] > /dev/null
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "col.h"
+
+#define DEFAULT_LINES 10000000
+#define CHUNK_LINES 100000
+
+static const char *PROGRAM = "main = map{ println }\n";
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    int lines = DEFAULT_LINES;
+    int i, j;
+    double elapsed = 0, start;
+    enum col_flush_policy policy = COL_FLUSH_DEFAULT;
+    struct col_program *program = col_program_load(PROGRAM, strlen(PROGRAM));
+    struct col_function *f = col_program_find(program, "main");
+    struct col_value *chunk = NULL;
+
+    if(argc > 1)
+        lines = atoi(argv[1]);
+
+    if(argc > 2 && !strcmp(argv[2], "line"))
+        policy = COL_FLUSH_LINE;
+    else if(argc > 2 && !strcmp(argv[2], "block"))
+        policy = COL_FLUSH_BLOCK;
+    else if(argc > 2 && !strcmp(argv[2], "exit"))
+        policy = COL_FLUSH_EXIT;
+    col_set_output(0, policy);
+
+    // Lines are printed in chunks, and only the printing is timed
+    for(i = 0; i < lines; i += CHUNK_LINES)
+    {
+        chunk = col_value_seq();
+        for(j = i; j < i + CHUNK_LINES && j < lines; j++)
+            col_seq_push(chunk, col_value_string("a line of output"));
+
+        start = now();
+        col_value_delete(col_call(f, chunk));
+        elapsed += now() - start;
+    }
+
+    start = now();
+    col_flush();
+    elapsed += now() - start;
+
+    fprintf(stderr, "lines:      %10d\n", lines);
+    fprintf(stderr, "time:       %10.3f s\n", elapsed);
+    fprintf(stderr, "throughput: %10.1f Mlines/s\n", lines / elapsed / 1e6);
+
+    col_program_delete(program);
+    return 0;
+}
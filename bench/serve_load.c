@@ -0,0 +1,176 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+/**
+ * Load generator for colint --serve.  Starts a number of client
+ * threads, each of which sends the same request over its own
+ * connection and waits for every response before sending the next,
+ * then reports throughput and latency percentiles.
+ *
+ * Usage: serve_load <socket> <request> [clients] [requests per client]
+ *
+ * For example, against colint --serve /tmp/col.sock examples/collatz.col
+ *
+ *   serve_load /tmp/col.sock "collatz-seq 27" 8 10000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DEFAULT_CLIENTS 4
+#define DEFAULT_REQUESTS 10000
+#define RESPONSE_BUF_SIZE 65536
+
+struct client
+{
+    const char *socket;
+    const char *request;
+    int requests;
+    double *latencies;
+    int failed;
+};
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// Sends requests one at a time, timing each round trip
+void *run_client(void *arg)
+{
+    struct client *client = (struct client*)arg;
+    struct sockaddr_un address;
+    char buf[RESPONSE_BUF_SIZE];
+    int fd, i, n;
+    int length = strlen(client->request);
+    double start;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, client->socket, sizeof(address.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)))
+    {
+        client->failed = 1;
+        return NULL;
+    }
+
+    for(i = 0; i < client->requests; i++)
+    {
+        start = now();
+        if(write(fd, client->request, length) != length)
+        {
+            client->failed = 1;
+            break;
+        }
+
+        // Reading until the end of the response line
+        do
+        {
+            n = read(fd, buf, RESPONSE_BUF_SIZE);
+        } while(n > 0 && buf[n - 1] != '\n');
+
+        if(n <= 0)
+        {
+            client->failed = 1;
+            break;
+        }
+        client->latencies[i] = now() - start;
+    }
+
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int clients = DEFAULT_CLIENTS;
+    int requests = DEFAULT_REQUESTS;
+    int i, total;
+    char *request = NULL;
+    double start, elapsed;
+    double *latencies = NULL;
+    struct client *state = NULL;
+    pthread_t *threads = NULL;
+
+    if(argc < 3)
+    {
+        printf("Usage: serve_load <socket> <request> [clients] "
+               "[requests per client]\n");
+        return 1;
+    }
+    if(argc > 3)
+        clients = atoi(argv[3]);
+    if(argc > 4)
+        requests = atoi(argv[4]);
+
+    request = (char*)malloc(strlen(argv[2]) + 2);
+    sprintf(request, "%s\n", argv[2]);
+
+    total = clients * requests;
+    latencies = (double*)calloc(total, sizeof(double));
+    state = (struct client*)calloc(clients, sizeof(struct client));
+    threads = (pthread_t*)calloc(clients, sizeof(pthread_t));
+
+    start = now();
+    for(i = 0; i < clients; i++)
+    {
+        state[i].socket = argv[1];
+        state[i].request = request;
+        state[i].requests = requests;
+        state[i].latencies = latencies + i * requests;
+        pthread_create(&threads[i], NULL, run_client, &state[i]);
+    }
+    for(i = 0; i < clients; i++)
+    {
+        pthread_join(threads[i], NULL);
+        if(state[i].failed)
+        {
+            printf("Error: Client %d failed\n", i);
+            return 1;
+        }
+    }
+    elapsed = now() - start;
+
+    qsort(latencies, total, sizeof(double), compare_doubles);
+    printf("requests:   %d\n", total);
+    printf("throughput: %.0f requests/s\n", total / elapsed);
+    printf("p50:        %.1f us\n", latencies[total / 2] * 1e6);
+    printf("p99:        %.1f us\n", latencies[total * 99 / 100] * 1e6);
+    printf("max:        %.1f us\n", latencies[total - 1] * 1e6);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+/**
+ * Times the sort primitives on random ints, floats and strings, and
+ * topk and sortby on the same ints.  Copying the ints with id is timed
+ * as well, since building and freeing the values around a call takes a
+ * good part of each time.
+ *
+ * Usage: sort_throughput [length]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "col.h"
+
+#define DEFAULT_LENGTH 10000000
+
+static const char *PROGRAM =
+    "copy = id\n"
+    "sort = sort\n"
+    "topk = topk(10)\n"
+    "sortby = sortby{ id }\n";
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Builds a sequence of random values, ints, floats or strings
+struct col_value *input(int length, enum col_value_type type)
+{
+    int i;
+    char text[16];
+    struct col_value *seq = col_value_seq();
+
+    srand(length);
+    for(i = 0; i < length; i++)
+    {
+        if(type == COL_INT)
+        {
+            col_seq_push(seq, col_value_int(rand() - RAND_MAX / 2));
+        }
+        else if(type == COL_FLOAT)
+        {
+            col_seq_push(seq, col_value_float(rand() / (double)RAND_MAX));
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%x", rand());
+            col_seq_push(seq, col_value_string(text));
+        }
+    }
+
+    return seq;
+}
+
+// Times a single call to a function on a new input, and prints it
+void time_function(struct col_program *program, const char *name,
+                   const char *label, int length, enum col_value_type type)
+{
+    double start;
+    struct col_value *in = input(length, type);
+    struct col_value *out = NULL;
+
+    start = now();
+    out = col_call(col_program_find(program, name), in);
+    printf("%-16s %8.3f s\n", label, now() - start);
+
+    if(col_value_type(out) != COL_SEQ)
+    {
+        printf("%s returned the wrong result\n", name);
+        exit(1);
+    }
+    col_value_delete(out);
+}
+
+int main(int argc, char *argv[])
+{
+    int length = DEFAULT_LENGTH;
+    struct col_program *program = NULL;
+
+    if(argc > 1)
+        length = atoi(argv[1]);
+
+    program = col_program_load(PROGRAM, strlen(PROGRAM));
+
+    printf("%d elements\n", length);
+    time_function(program, "copy", "id ints", length, COL_INT);
+    time_function(program, "sort", "sort ints", length, COL_INT);
+    time_function(program, "sort", "sort floats", length, COL_FLOAT);
+    time_function(program, "sort", "sort strings", length, COL_STRING);
+    time_function(program, "topk", "topk(10) ints", length, COL_INT);
+    time_function(program, "sortby", "sortby{ id } ints", length, COL_INT);
+
+    col_program_delete(program);
+    return 0;
+}
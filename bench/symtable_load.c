@@ -0,0 +1,88 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+/**
+ * Measures how long a program with many definitions takes to load, which
+ * is dominated by adding every definition to the symtable and looking
+ * them up again when they're linked.  Names share long prefixes, like
+ * those in generated programs.
+ *
+ * Usage: symtable_load [definitions]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "col.h"
+
+#define DEFAULT_DEFINITIONS 100000
+
+// Each definition refers to the one before it, so linking looks up every
+// name once more
+static const char *DEFINITION =
+    "report-col-%d-total = compose{ report-col-%d-total, id }\n";
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    int definitions = DEFAULT_DEFINITIONS;
+    int i;
+    size_t length = 0;
+    size_t size;
+    char *source = NULL;
+    double start, elapsed;
+    struct col_program *program = NULL;
+
+    if(argc > 1)
+        definitions = atoi(argv[1]);
+
+    size = (size_t)definitions * (strlen(DEFINITION) + 20) + 1;
+    source = (char*)malloc(size);
+    for(i = 0; i < definitions; i++)
+        length += snprintf(source + length, size - length, DEFINITION,
+                           i, i > 0 ? i - 1 : 0);
+
+    start = now();
+    program = col_program_load(source, length);
+    elapsed = now() - start;
+
+    if(!program)
+    {
+        printf("Error: Generated source failed to load\n");
+        return 1;
+    }
+
+    printf("definitions:    %10d\n", definitions);
+    printf("load time:      %10.3f s\n", elapsed);
+    printf("per definition: %10.3f us\n", elapsed / definitions * 1e6);
+
+    col_program_delete(program);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+/**
+ * Compares the elementwise vector primitives with the same operations
+ * written as map over trans or distr, which builds a pair per element.
+ *
+ * Usage: vector_ops [length] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "col.h"
+
+#define DEFAULT_LENGTH 100000
+#define DEFAULT_ITERATIONS 20
+
+static const char *PROGRAM =
+    "vadd = v+\n"
+    "madd = compose{ map{ + }, trans }\n"
+    "vscale = compose{ v*, construct{ id, const(3) } }\n"
+    "mscale = compose{ map{ * }, distr, construct{ id, const(3) } }\n";
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Builds the sequence 0, 1, 2... of the given length
+struct col_value *numbers(int length)
+{
+    int i;
+    struct col_value *seq = col_value_seq();
+
+    for(i = 0; i < length; i++)
+        col_seq_push(seq, col_value_int(i));
+    return seq;
+}
+
+// Builds the input for one call, a pair of sequences for binary functions
+// or a single sequence otherwise
+struct col_value *input(int length, int pair)
+{
+    struct col_value *in = NULL;
+
+    if(!pair)
+        return numbers(length);
+
+    in = col_value_seq();
+    col_seq_push(in, numbers(length));
+    col_seq_push(in, numbers(length));
+    return in;
+}
+
+// Times repeated calls to a function, building each input outside of
+// the timed region, and prints the time per element
+double time_function(struct col_program *program, const char *name,
+                     int length, int iterations, int pair)
+{
+    int i;
+    double start;
+    double total = 0;
+    struct col_function *f = col_program_find(program, name);
+    struct col_value *in = NULL;
+    struct col_value *out = NULL;
+
+    for(i = 0; i < iterations; i++)
+    {
+        in = input(length, pair);
+        start = now();
+        out = col_call(f, in);
+        total += now() - start;
+
+        if(col_value_type(out) != COL_SEQ || col_seq_length(out) != length)
+        {
+            printf("%s returned the wrong result\n", name);
+            exit(1);
+        }
+        col_value_delete(out);
+    }
+
+    total /= (double)iterations * length;
+    printf("%-8s %10.2f ns/element\n", name, total * 1e9);
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    int length = DEFAULT_LENGTH;
+    int iterations = DEFAULT_ITERATIONS;
+    double vector, mapped;
+    struct col_program *program = NULL;
+
+    if(argc > 1)
+        length = atoi(argv[1]);
+    if(argc > 2)
+        iterations = atoi(argv[2]);
+
+    program = col_program_load(PROGRAM, strlen(PROGRAM));
+
+    vector = time_function(program, "vadd", length, iterations, 1);
+    mapped = time_function(program, "madd", length, iterations, 1);
+    printf("speedup:  %10.1fx\n", mapped / vector);
+
+    vector = time_function(program, "vscale", length, iterations, 0);
+    mapped = time_function(program, "mscale", length, iterations, 0);
+    printf("speedup:  %10.1fx\n", mapped / vector);
+
+    col_program_delete(program);
+    return 0;
+}
@@ -0,0 +1,640 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "array.h"
+#include "interpreter.h"
+#include "list.h"
+
+// Kernels are cloned for AVX2 where the compiler can, and the best clone
+// is picked when the library is loaded
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ARRAY_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define ARRAY_KERNEL
+#endif
+
+// Applies F to each pair of elements of a and b into out, with a or b
+// standing for a single repeated element if it only has one
+#define ARRAY_LOOP(F, out, a, as, b, bs, count)            \
+    do                                                      \
+    {                                                       \
+        if(as && bs)                                        \
+            for(i = 0; i < count; i++)                      \
+                out[i] = F(a[i], b[i]);                     \
+        else if(as)                                         \
+            for(i = 0; i < count; i++)                      \
+                out[i] = F(a[i], b[0]);                     \
+        else                                                \
+            for(i = 0; i < count; i++)                      \
+                out[i] = F(a[0], b[i]);                     \
+    } while(0)
+
+// The elementwise operators, for ARRAY_LOOP
+#define ARRAY_PLUS(x, y) ((x) + (y))
+#define ARRAY_MINUS(x, y) ((x) - (y))
+#define ARRAY_TIMES(x, y) ((x) * (y))
+#define ARRAY_OVER(x, y) ((x) / (y))
+#define ARRAY_LESSER(x, y) ((x) < (y) ? (x) : (y))
+#define ARRAY_GREATER(x, y) ((x) > (y) ? (x) : (y))
+
+// Checks a nested sequence against a shape, returns 0 if it doesn't fit
+// and sets is_float if any of its numbers are floats
+int array_check(struct value *value, int rank, const int *shape,
+                int *is_float);
+// Copies the numbers of a nested sequence into an array, returns the
+// next position to fill
+int array_fill(struct array *array, struct value *value, int depth,
+               int position);
+// Unpacks the elements of an array from position onward into nested
+// sequences of its shape from depth down
+struct value *array_unpack_from(struct array *array, int depth,
+                                int *position);
+// Returns a float copy of an int array, or a new reference to a float one
+struct array *array_floats(struct array *array);
+
+// The kernels for each element type
+void array_multiply_ints(const int *restrict a, const int *restrict b,
+                         int *restrict c, int n, int m, int p);
+void array_multiply_floats(const float *restrict a, const float *restrict b,
+                           float *restrict c, int n, int m, int p);
+void array_apply_ints(enum array_op op, const int *restrict a, int as,
+                      const int *restrict b, int bs, int *restrict out,
+                      int count);
+void array_apply_floats(enum array_op op, const float *restrict a, int as,
+                        const float *restrict b, int bs,
+                        float *restrict out, int count);
+void array_map_ints(enum array_fn fn, const int *restrict a,
+                    int *restrict out, int count);
+void array_map_floats(enum array_fn fn, const float *restrict a,
+                      float *restrict out, int count);
+void array_sum_ints(const int *restrict in, int *restrict out,
+                    int outer, int length, int inner);
+void array_sum_floats(const float *restrict in, float *restrict out,
+                      int outer, int length, int inner);
+
+// Creates an array of the given shape with its elements uninitialized
+struct array *array_new(int is_float, int rank, const int *shape)
+{
+    struct array *array = (struct array*)malloc(sizeof(struct array));
+    int i;
+
+    array->refs = 1;
+    array->is_float = is_float;
+    array->rank = rank;
+    array->shape = (int*)malloc((rank ? rank : 1) * sizeof(int));
+    array->count = 1;
+    for(i = 0; i < rank; i++)
+    {
+        array->shape[i] = shape[i];
+        array->count *= shape[i];
+    }
+
+    // Rows are aligned for the vector units, and never empty so that
+    // malloc always gives something to free
+    if(is_float)
+        array->data.floats = (float*)aligned_alloc(ARRAY_BLOCK,
+            ((array->count * sizeof(float)) / ARRAY_BLOCK + 1) * ARRAY_BLOCK);
+    else
+        array->data.ints = (int*)aligned_alloc(ARRAY_BLOCK,
+            ((array->count * sizeof(int)) / ARRAY_BLOCK + 1) * ARRAY_BLOCK);
+
+    return array;
+}
+
+// Releases a reference to an array, freeing it once it has no others
+void array_release(struct array *array)
+{
+    if(--array->refs > 0)
+        return;
+
+    if(array->is_float)
+        free(array->data.floats);
+    else
+        free(array->data.ints);
+    free(array->shape);
+    free(array);
+}
+
+// Wraps an array in a new value, taking ownership of it
+struct value *array_value(struct array *array)
+{
+    struct value *value = value_new();
+
+    value->type = ARRAY_VAL;
+    value->data.array_val = array;
+    return value;
+}
+
+// Packs a rectangular sequence of numbers, nested to any depth, into a new
+// array, returns NULL if it isn't one
+struct array *array_pack(struct value *value)
+{
+    struct array *array = NULL;
+    struct value *v = NULL;
+    int shape[ARRAY_MAX_RANK];
+    int rank = 0;
+    int is_float = 0;
+
+    // The first element at each depth gives the shape, which everything
+    // else is checked against
+    for(v = value; v->type == SEQ_VAL; v = v->data.seq_val->front->data)
+    {
+        if(rank == ARRAY_MAX_RANK)
+            return NULL;
+
+        shape[rank++] = v->data.seq_val->count;
+        if(!v->data.seq_val->count)
+            break;
+    }
+
+    if(!rank || !array_check(value, rank, shape, &is_float))
+        return NULL;
+
+    array = array_new(is_float, rank, shape);
+    array_fill(array, value, 0, 0);
+    return array;
+}
+
+// Checks a nested sequence against a shape, returns 0 if it doesn't fit
+// and sets is_float if any of its numbers are floats
+int array_check(struct value *value, int rank, const int *shape,
+                int *is_float)
+{
+    struct list_node *node = NULL;
+
+    if(!rank)
+    {
+        if(value->type == FLOAT_VAL)
+            *is_float = 1;
+        return value->type == INT_VAL || value->type == FLOAT_VAL;
+    }
+
+    if(value->type != SEQ_VAL || value->data.seq_val->count != shape[0])
+        return 0;
+
+    for(node = value->data.seq_val->front; node; node = node->next)
+        if(!array_check(node->data, rank - 1, shape + 1, is_float))
+            return 0;
+
+    return 1;
+}
+
+// Copies the numbers of a nested sequence into an array, returns the
+// next position to fill
+int array_fill(struct array *array, struct value *value, int depth,
+               int position)
+{
+    struct list_node *node = NULL;
+
+    if(depth < array->rank)
+    {
+        for(node = value->data.seq_val->front; node; node = node->next)
+            position = array_fill(array, node->data, depth + 1, position);
+        return position;
+    }
+
+    if(!array->is_float)
+        array->data.ints[position] = value->data.int_val;
+    else if(value->type == INT_VAL)
+        array->data.floats[position] = value->data.int_val;
+    else
+        array->data.floats[position] = value->data.float_val;
+
+    return position + 1;
+}
+
+// Unpacks an array into nested sequences
+struct value *array_unpack(struct array *array)
+{
+    int position = 0;
+
+    return array_unpack_from(array, 0, &position);
+}
+
+// Unpacks the elements of an array from position onward into nested
+// sequences of its shape from depth down
+struct value *array_unpack_from(struct array *array, int depth,
+                                int *position)
+{
+    struct value *value = value_new();
+    int i;
+
+    if(depth == array->rank)
+    {
+        if(array->is_float)
+        {
+            value->type = FLOAT_VAL;
+            value->data.float_val = array->data.floats[(*position)++];
+        }
+        else
+        {
+            value->type = INT_VAL;
+            value->data.int_val = array->data.ints[(*position)++];
+        }
+        return value;
+    }
+
+    value->type = SEQ_VAL;
+    value->data.seq_val = list_new();
+    for(i = 0; i < array->shape[depth]; i++)
+        list_push_back(value->data.seq_val,
+                       array_unpack_from(array, depth + 1, position));
+    return value;
+}
+
+// Checks whether two arrays have the same shape and elements
+int array_equal(struct array *a, struct array *b)
+{
+    int i;
+
+    if(a->is_float != b->is_float || a->rank != b->rank)
+        return 0;
+
+    for(i = 0; i < a->rank; i++)
+        if(a->shape[i] != b->shape[i])
+            return 0;
+
+    for(i = 0; i < a->count; i++)
+        if(a->is_float ? a->data.floats[i] != b->data.floats[i]
+           : a->data.ints[i] != b->data.ints[i])
+            return 0;
+
+    return 1;
+}
+
+// Returns a float copy of an int array, or a new reference to a float one
+struct array *array_floats(struct array *array)
+{
+    struct array *copy = NULL;
+    int i;
+
+    if(array->is_float)
+    {
+        array->refs++;
+        return array;
+    }
+
+    copy = array_new(1, array->rank, array->shape);
+    for(i = 0; i < array->count; i++)
+        copy->data.floats[i] = array->data.ints[i];
+    return copy;
+}
+
+// Multiplies two matrices, returns NULL if their shapes don't fit
+struct array *array_multiply(struct array *a, struct array *b)
+{
+    struct array *c = NULL;
+    int shape[2];
+
+    if(a->rank != 2 || b->rank != 2 || a->shape[1] != b->shape[0])
+        return NULL;
+
+    shape[0] = a->shape[0];
+    shape[1] = b->shape[1];
+
+    if(!a->is_float && !b->is_float)
+    {
+        c = array_new(0, 2, shape);
+        array_multiply_ints(a->data.ints, b->data.ints, c->data.ints,
+                            shape[0], a->shape[1], shape[1]);
+        return c;
+    }
+
+    a = array_floats(a);
+    b = array_floats(b);
+    c = array_new(1, 2, shape);
+    array_multiply_floats(a->data.floats, b->data.floats, c->data.floats,
+                          shape[0], a->shape[1], shape[1]);
+    array_release(a);
+    array_release(b);
+    return c;
+}
+
+// Multiplies an n by m matrix by an m by p one, a block at a time so that
+// the rows being worked on stay in cache.  The innermost loop runs along
+// rows of b and c, so it's vectorized.
+ARRAY_KERNEL
+void array_multiply_ints(const int *restrict a, const int *restrict b,
+                         int *restrict c, int n, int m, int p)
+{
+    int i, j, k, ii, jj, kk;
+    int imax, jmax, kmax;
+    int x;
+
+    memset(c, 0, (size_t)n * p * sizeof(int));
+    for(ii = 0; ii < n; ii += ARRAY_BLOCK)
+    {
+        imax = ii + ARRAY_BLOCK < n ? ii + ARRAY_BLOCK : n;
+        for(kk = 0; kk < m; kk += ARRAY_BLOCK)
+        {
+            kmax = kk + ARRAY_BLOCK < m ? kk + ARRAY_BLOCK : m;
+            for(jj = 0; jj < p; jj += ARRAY_BLOCK)
+            {
+                jmax = jj + ARRAY_BLOCK < p ? jj + ARRAY_BLOCK : p;
+                for(i = ii; i < imax; i++)
+                {
+                    for(k = kk; k < kmax; k++)
+                    {
+                        x = a[(size_t)i * m + k];
+                        for(j = jj; j < jmax; j++)
+                            c[(size_t)i * p + j] += x * b[(size_t)k * p + j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Multiplies an n by m matrix by an m by p one, as array_multiply_ints
+ARRAY_KERNEL
+void array_multiply_floats(const float *restrict a, const float *restrict b,
+                           float *restrict c, int n, int m, int p)
+{
+    int i, j, k, ii, jj, kk;
+    int imax, jmax, kmax;
+    float x;
+
+    memset(c, 0, (size_t)n * p * sizeof(float));
+    for(ii = 0; ii < n; ii += ARRAY_BLOCK)
+    {
+        imax = ii + ARRAY_BLOCK < n ? ii + ARRAY_BLOCK : n;
+        for(kk = 0; kk < m; kk += ARRAY_BLOCK)
+        {
+            kmax = kk + ARRAY_BLOCK < m ? kk + ARRAY_BLOCK : m;
+            for(jj = 0; jj < p; jj += ARRAY_BLOCK)
+            {
+                jmax = jj + ARRAY_BLOCK < p ? jj + ARRAY_BLOCK : p;
+                for(i = ii; i < imax; i++)
+                {
+                    for(k = kk; k < kmax; k++)
+                    {
+                        x = a[(size_t)i * m + k];
+                        for(j = jj; j < jmax; j++)
+                            c[(size_t)i * p + j] += x * b[(size_t)k * p + j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Applies an operator to each pair of corresponding elements, either of
+// which may be a single number repeated, returns NULL if their shapes
+// differ.  Division always gives floats.
+struct array *array_apply(enum array_op op, struct array *a,
+                          struct array *b)
+{
+    struct array *out = NULL;
+    struct array *shape = NULL;
+    int i;
+
+    // A single number has no dimensions, and takes the other's shape
+    if(a->rank && b->rank)
+    {
+        if(a->rank != b->rank)
+            return NULL;
+        for(i = 0; i < a->rank; i++)
+            if(a->shape[i] != b->shape[i])
+                return NULL;
+    }
+    shape = a->rank ? a : b;
+
+    if(!a->is_float && !b->is_float && op != ARRAY_DIVIDE)
+    {
+        out = array_new(0, shape->rank, shape->shape);
+        array_apply_ints(op, a->data.ints, a->rank, b->data.ints, b->rank,
+                         out->data.ints, out->count);
+        return out;
+    }
+
+    a = array_floats(a);
+    b = array_floats(b);
+    out = array_new(1, shape->rank, shape->shape);
+    array_apply_floats(op, a->data.floats, a->rank, b->data.floats, b->rank,
+                       out->data.floats, out->count);
+    array_release(a);
+    array_release(b);
+    return out;
+}
+
+// Applies an operator elementwise to ints, a or b is a single repeated
+// element if its step, as or bs, is zero
+ARRAY_KERNEL
+void array_apply_ints(enum array_op op, const int *restrict a, int as,
+                      const int *restrict b, int bs, int *restrict out,
+                      int count)
+{
+    int i;
+
+    switch(op)
+    {
+    case ARRAY_ADD:
+        ARRAY_LOOP(ARRAY_PLUS, out, a, as, b, bs, count);
+        break;
+    case ARRAY_SUBTRACT:
+        ARRAY_LOOP(ARRAY_MINUS, out, a, as, b, bs, count);
+        break;
+    case ARRAY_MULTIPLY:
+        ARRAY_LOOP(ARRAY_TIMES, out, a, as, b, bs, count);
+        break;
+    case ARRAY_DIVIDE:
+        // Integer division is done in floats instead
+        break;
+    case ARRAY_MIN:
+        ARRAY_LOOP(ARRAY_LESSER, out, a, as, b, bs, count);
+        break;
+    case ARRAY_MAX:
+        ARRAY_LOOP(ARRAY_GREATER, out, a, as, b, bs, count);
+        break;
+    }
+}
+
+// Applies an operator elementwise to floats, a or b is a single repeated
+// element if its step, as or bs, is zero
+ARRAY_KERNEL
+void array_apply_floats(enum array_op op, const float *restrict a, int as,
+                        const float *restrict b, int bs,
+                        float *restrict out, int count)
+{
+    int i;
+
+    switch(op)
+    {
+    case ARRAY_ADD:
+        ARRAY_LOOP(ARRAY_PLUS, out, a, as, b, bs, count);
+        break;
+    case ARRAY_SUBTRACT:
+        ARRAY_LOOP(ARRAY_MINUS, out, a, as, b, bs, count);
+        break;
+    case ARRAY_MULTIPLY:
+        ARRAY_LOOP(ARRAY_TIMES, out, a, as, b, bs, count);
+        break;
+    case ARRAY_DIVIDE:
+        ARRAY_LOOP(ARRAY_OVER, out, a, as, b, bs, count);
+        break;
+    case ARRAY_MIN:
+        ARRAY_LOOP(ARRAY_LESSER, out, a, as, b, bs, count);
+        break;
+    case ARRAY_MAX:
+        ARRAY_LOOP(ARRAY_GREATER, out, a, as, b, bs, count);
+        break;
+    }
+}
+
+// Applies a function to each element of an array.  Square roots always
+// give floats.
+struct array *array_map(enum array_fn fn, struct array *array)
+{
+    struct array *out = NULL;
+
+    if(!array->is_float && fn != ARRAY_SQRT)
+    {
+        out = array_new(0, array->rank, array->shape);
+        array_map_ints(fn, array->data.ints, out->data.ints, out->count);
+        return out;
+    }
+
+    array = array_floats(array);
+    out = array_new(1, array->rank, array->shape);
+    array_map_floats(fn, array->data.floats, out->data.floats, out->count);
+    array_release(array);
+    return out;
+}
+
+// Applies a function to each of count ints
+ARRAY_KERNEL
+void array_map_ints(enum array_fn fn, const int *restrict a,
+                    int *restrict out, int count)
+{
+    int i;
+
+    switch(fn)
+    {
+    case ARRAY_ABS:
+        for(i = 0; i < count; i++)
+            out[i] = a[i] < 0 ? -a[i] : a[i];
+        break;
+    case ARRAY_SQRT:
+        // Square roots are taken in floats instead
+        break;
+    }
+}
+
+// Applies a function to each of count floats
+ARRAY_KERNEL
+void array_map_floats(enum array_fn fn, const float *restrict a,
+                      float *restrict out, int count)
+{
+    int i;
+
+    switch(fn)
+    {
+    case ARRAY_ABS:
+        for(i = 0; i < count; i++)
+            out[i] = fabsf(a[i]);
+        break;
+    case ARRAY_SQRT:
+        for(i = 0; i < count; i++)
+            out[i] = sqrtf(a[i]);
+        break;
+    }
+}
+
+// Sums an array along one of its axes, or along all of them if axis is
+// negative, in which case the result has no dimensions.  Returns NULL if
+// there's no such axis.
+struct array *array_sum(struct array *array, int axis)
+{
+    struct array *out = NULL;
+    int shape[ARRAY_MAX_RANK];
+    int length;
+    int outer = 1;
+    int inner = 1;
+    int i, j;
+
+    if(axis >= array->rank)
+        return NULL;
+
+    if(axis < 0)
+    {
+        // Summing everything is summing along one axis of all the elements
+        length = array->count;
+        out = array_new(array->is_float, 0, NULL);
+    }
+    else
+    {
+        // Elements are grouped into those before the axis and those after
+        // it, and each run along the axis is added into the same row of
+        // the result
+        length = array->shape[axis];
+        for(i = 0, j = 0; i < array->rank; i++)
+        {
+            if(i < axis)
+                outer *= array->shape[i];
+            else if(i > axis)
+                inner *= array->shape[i];
+            if(i != axis)
+                shape[j++] = array->shape[i];
+        }
+        out = array_new(array->is_float, array->rank - 1, shape);
+    }
+
+    if(array->is_float)
+        array_sum_floats(array->data.floats, out->data.floats,
+                         outer, length, inner);
+    else
+        array_sum_ints(array->data.ints, out->data.ints,
+                       outer, length, inner);
+    return out;
+}
+
+// Adds outer groups of length rows of inner ints each into outer rows
+ARRAY_KERNEL
+void array_sum_ints(const int *restrict in, int *restrict out,
+                    int outer, int length, int inner)
+{
+    int i, j, k;
+
+    memset(out, 0, (size_t)outer * inner * sizeof(int));
+    for(i = 0; i < outer; i++)
+        for(j = 0; j < length; j++)
+            for(k = 0; k < inner; k++)
+                out[(size_t)i * inner + k]
+                    += in[((size_t)i * length + j) * inner + k];
+}
+
+// Adds outer groups of length rows of inner floats each into outer rows
+ARRAY_KERNEL
+void array_sum_floats(const float *restrict in, float *restrict out,
+                      int outer, int length, int inner)
+{
+    int i, j, k;
+
+    memset(out, 0, (size_t)outer * inner * sizeof(float));
+    for(i = 0; i < outer; i++)
+        for(j = 0; j < length; j++)
+            for(k = 0; k < inner; k++)
+                out[(size_t)i * inner + k]
+                    += in[((size_t)i * length + j) * inner + k];
+}
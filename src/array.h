@@ -0,0 +1,107 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#define ARRAY_BLOCK 64     // Rows and columns in each block of a multiply
+#define ARRAY_MAX_RANK 32  // Most dimensions an array may have
+
+/**
+ * Dense numeric arrays.  An array holds ints or floats packed together in
+ * row-major order, with any number of dimensions.  Arrays are made from
+ * nested sequences that are rectangular, turned back into them when they
+ * leave the interpreter, and are never modified once made, so copies
+ * share a single array.
+ *
+ * The arithmetic kernels are built for the best vector instructions the
+ * processor supports, chosen when the library is loaded.
+ */
+
+struct value;
+
+struct array
+{
+    // Number of values sharing the array
+    int refs;
+    // Set if the elements are floats, otherwise they're ints
+    int is_float;
+    // Number of dimensions, and the length of each
+    int rank;
+    int *shape;
+    // Total number of elements
+    int count;
+    union
+    {
+        int *ints;
+        float *floats;
+    } data;
+};
+
+// Elementwise operators
+enum array_op
+{
+    ARRAY_ADD,
+    ARRAY_SUBTRACT,
+    ARRAY_MULTIPLY,
+    ARRAY_DIVIDE,
+    ARRAY_MIN,
+    ARRAY_MAX
+};
+
+// Elementwise functions
+enum array_fn
+{
+    ARRAY_ABS,
+    ARRAY_SQRT
+};
+
+// Creates an array of the given shape with its elements uninitialized
+struct array *array_new(int is_float, int rank, const int *shape);
+// Releases a reference to an array, freeing it once it has no others
+void array_release(struct array *array);
+// Wraps an array in a new value, taking ownership of it
+struct value *array_value(struct array *array);
+
+// Packs a rectangular sequence of numbers, nested to any depth, into a new
+// array, returns NULL if it isn't one
+struct array *array_pack(struct value *value);
+// Unpacks an array into nested sequences
+struct value *array_unpack(struct array *array);
+// Checks whether two arrays have the same shape and elements
+int array_equal(struct array *a, struct array *b);
+
+// Multiplies two matrices, returns NULL if their shapes don't fit
+struct array *array_multiply(struct array *a, struct array *b);
+// Applies an operator to each pair of corresponding elements, either of
+// which may be a single number repeated, returns NULL if their shapes
+// differ.  Division always gives floats.
+struct array *array_apply(enum array_op op, struct array *a,
+                          struct array *b);
+// Applies a function to each element of an array.  Square roots always
+// give floats.
+struct array *array_map(enum array_fn fn, struct array *array);
+// Sums an array along one of its axes, or along all of them if axis is
+// negative, in which case the result has no dimensions.  Returns NULL if
+// there's no such axis.
+struct array *array_sum(struct array *array, int axis);
+
+#endif // ARRAY_H
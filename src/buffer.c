@@ -0,0 +1,115 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+
+#define BUFFER_STARTSIZE 64
+
+// Makes room for at least length more bytes plus the terminator
+void buffer_reserve(struct buffer *buffer, int length);
+
+// Returns an empty buffer
+struct buffer *buffer_new()
+{
+    struct buffer *retval = (struct buffer*)malloc(sizeof(struct buffer));
+    retval->size = BUFFER_STARTSIZE;
+    retval->length = 0;
+    retval->data = (char*)malloc(retval->size);
+    retval->data[0] = '\0';
+    return retval;
+}
+
+// Deletes a buffer
+void buffer_delete(struct buffer *buffer)
+{
+    if(!buffer)
+        return;
+
+    free(buffer->data);
+    free(buffer);
+}
+
+// Appends length bytes to the end of a buffer
+void buffer_append(struct buffer *buffer, const char *data, int length)
+{
+    buffer_reserve(buffer, length);
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+// Appends a null-terminated string to the end of a buffer
+void buffer_append_str(struct buffer *buffer, const char *s)
+{
+    buffer_append(buffer, s, strlen(s));
+}
+
+// Appends a single character to the end of a buffer
+void buffer_append_char(struct buffer *buffer, char c)
+{
+    buffer_reserve(buffer, 1);
+    buffer->data[buffer->length++] = c;
+    buffer->data[buffer->length] = '\0';
+}
+
+// Removes length bytes from the front of a buffer
+void buffer_consume(struct buffer *buffer, int length)
+{
+    if(length >= buffer->length)
+    {
+        buffer_clear(buffer);
+        return;
+    }
+
+    memmove(buffer->data, buffer->data + length, buffer->length - length);
+    buffer->length -= length;
+    buffer->data[buffer->length] = '\0';
+}
+
+// Empties a buffer without releasing its memory
+void buffer_clear(struct buffer *buffer)
+{
+    buffer->length = 0;
+    buffer->data[0] = '\0';
+}
+
+// Releases a buffer, handing its contents to the caller
+char *buffer_release(struct buffer *buffer)
+{
+    char *retval = buffer->data;
+    free(buffer);
+    return retval;
+}
+
+// Makes room for at least length more bytes plus the terminator
+void buffer_reserve(struct buffer *buffer, int length)
+{
+    if(buffer->length + length < buffer->size)
+        return;
+
+    // Doubling the buffer size until the new data fits
+    while(buffer->length + length >= buffer->size)
+        buffer->size *= 2;
+    buffer->data = (char*)realloc(buffer->data, buffer->size);
+}
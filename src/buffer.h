@@ -0,0 +1,51 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef BUFFER_H
+#define BUFFER_H
+
+// A growable byte buffer, always kept null-terminated
+struct buffer
+{
+    char *data;
+    int length;
+    int size;
+};
+
+// Returns an empty buffer
+struct buffer *buffer_new();
+// Deletes a buffer
+void buffer_delete(struct buffer *buffer);
+
+// Appends length bytes to the end of a buffer
+void buffer_append(struct buffer *buffer, const char *data, int length);
+// Appends a null-terminated string to the end of a buffer
+void buffer_append_str(struct buffer *buffer, const char *s);
+// Appends a single character to the end of a buffer
+void buffer_append_char(struct buffer *buffer, char c);
+// Removes length bytes from the front of a buffer
+void buffer_consume(struct buffer *buffer, int length);
+// Empties a buffer without releasing its memory
+void buffer_clear(struct buffer *buffer);
+// Releases a buffer, handing its contents to the caller
+char *buffer_release(struct buffer *buffer);
+
+#endif // BUFFER_H
@@ -0,0 +1,389 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "col.h"
+#include "file.h"
+#include "lexer.h"
+#include "parser.h"
+#include "symtable.h"
+#include "interpreter.h"
+#include "list.h"
+#include "buffer.h"
+#include "server.h"
+#include "image.h"
+#include "io.h"
+#include "optimizer.h"
+#include "stack.h"
+
+// The public structs are never defined, pointers to them are just
+// internal structs in disguise
+#define VALUE(v) ((struct value*)(v))
+#define COL_VALUE(v) ((struct col_value*)(v))
+#define FUNCTION(f) ((struct function*)(f))
+#define COL_FUNCTION(f) ((struct col_function*)(f))
+
+struct col_program
+{
+    struct symtable *table;
+};
+
+// Loads a program from a source buffer, returns NULL on error
+struct col_program *col_program_load(const char *source, size_t length)
+{
+    struct lexer_state *lexer = lexer_new();
+    struct symtable *table = NULL;
+    struct col_program *program = NULL;
+
+    lexer_init(lexer, source, length);
+    table = parse(lexer);
+    lexer_delete(lexer);
+
+    if(!table)
+        return NULL;
+
+    symtable_link(table);
+
+    program = (struct col_program*)malloc(sizeof(struct col_program));
+    program->table = table;
+    return program;
+}
+
+// Loads a program from a source file or image, returns NULL on error
+struct col_program *col_program_load_file(const char *path)
+{
+    struct col_program *program = NULL;
+    struct symtable *table = NULL;
+    struct file_data *input = NULL;
+
+    // Images are already parsed and linked
+    if(image_detect(path))
+    {
+        table = image_read(path);
+        if(!table)
+            return NULL;
+
+        program = (struct col_program*)malloc(sizeof(struct col_program));
+        program->table = table;
+        return program;
+    }
+
+    input = read_file(path);
+    if(!input)
+        return NULL;
+
+    program = col_program_load(input->data, input->length);
+    file_data_delete(input);
+    return program;
+}
+
+// Compiles a source file into a program image, returns 0 on error
+int col_program_compile(const char *source_path, const char *image_path)
+{
+    int written = 0;
+    char full_path[PATH_MAX];
+    struct file_data *input = read_file(source_path);
+    struct col_program *program = NULL;
+
+    if(!input)
+        return 0;
+
+    program = col_program_load(input->data, input->length);
+    if(program)
+    {
+        // The image records an absolute path, so it can find its source
+        // no matter where it's run from
+        if(!realpath(source_path, full_path))
+            snprintf(full_path, PATH_MAX, "%s", source_path);
+
+        written = image_write(program->table, input->data, input->length,
+                              full_path, image_path);
+        if(!written)
+            printf("Error: Couldn't write %s\n", image_path);
+        col_program_delete(program);
+    }
+
+    file_data_delete(input);
+    return written;
+}
+
+// Deletes a program along with all of its functions
+void col_program_delete(struct col_program *program)
+{
+    if(!program)
+        return;
+
+    symtable_delete(program->table);
+    free(program);
+}
+
+// Prints a text representation of every function in a program
+void col_program_print(struct col_program *program)
+{
+    symtable_print(program->table);
+}
+
+// Serves calls to a program's functions on a Unix domain socket
+int col_serve(struct col_program *program, const char *socket_path,
+              int threads)
+{
+    return server_run(program->table, socket_path, threads);
+}
+
+// Sets the buffer size in bytes, or zero for the default, and the flush
+// policy of the output buffers for standard output and standard error
+void col_set_output(int size, enum col_flush_policy policy)
+{
+    enum io_flush_policy io_policy = IO_FLUSH_DEFAULT;
+
+    switch(policy)
+    {
+    case COL_FLUSH_LINE:
+        io_policy = IO_FLUSH_LINE;
+        break;
+    case COL_FLUSH_BLOCK:
+        io_policy = IO_FLUSH_BLOCK;
+        break;
+    case COL_FLUSH_EXIT:
+        io_policy = IO_FLUSH_EXIT;
+        break;
+    default:
+        break;
+    }
+
+    io_configure(&IO_STDOUT, size, io_policy);
+    io_configure(&IO_STDERR, size, io_policy);
+}
+
+// Writes out anything waiting in the output buffers
+void col_flush()
+{
+    io_flush_all();
+}
+
+// Sets whether programs loaded from now on evaluate the elements of
+// construct only when they're needed
+void col_set_lazy(int lazy)
+{
+    OPTIMIZER_LAZY = lazy ? 1 : 0;
+}
+
+// Sets how much memory in megabytes each thread may use for the stack of
+// deep recursion, or zero for the default
+void col_set_stack_limit(int megabytes)
+{
+    int segment = STACK_SEGMENT_SIZE >> 20;
+    int segments = (megabytes + segment - 1) / segment;
+
+    if(megabytes <= 0)
+        segments = STACK_DEFAULT_SEGMENTS;
+    if(segments > STACK_MAX_SEGMENTS)
+        segments = STACK_MAX_SEGMENTS;
+
+    STACK_SEGMENT_LIMIT = segments;
+}
+
+// Finds a function by name, returns NULL if it isn't defined
+struct col_function *col_program_find(struct col_program *program,
+                                      const char *name)
+{
+    return COL_FUNCTION(symtable_find(program->table, (char*)name));
+}
+
+// Calls a function, takes ownership of in and returns a new value.  A
+// stream result is materialized and deferred elements are evaluated, so
+// the caller always gets plain values.
+struct col_value *col_call(struct col_function *function,
+                           struct col_value *in)
+{
+    return COL_VALUE(value_resolve(function_exec(FUNCTION(function),
+                                                 VALUE(in))));
+}
+
+struct col_value *col_value_int(int i)
+{
+    struct value *v = value_new();
+    v->type = INT_VAL;
+    v->data.int_val = i;
+    return COL_VALUE(v);
+}
+
+struct col_value *col_value_float(double f)
+{
+    struct value *v = value_new();
+    v->type = FLOAT_VAL;
+    v->data.float_val = f;
+    return COL_VALUE(v);
+}
+
+struct col_value *col_value_char(char c)
+{
+    struct value *v = value_new();
+    v->type = CHAR_VAL;
+    v->data.char_val = c;
+    return COL_VALUE(v);
+}
+
+struct col_value *col_value_string(const char *s)
+{
+    struct value *v = value_new();
+    v->type = STRING_VAL;
+    string_init(&v->data.str_val, s, strlen(s));
+    return COL_VALUE(v);
+}
+
+struct col_value *col_value_bool(int b)
+{
+    struct value *v = value_new();
+    v->type = BOOL_VAL;
+    v->data.bool_val = b ? 1 : 0;
+    return COL_VALUE(v);
+}
+
+struct col_value *col_value_bottom()
+{
+    return COL_VALUE(value_new());
+}
+
+struct col_value *col_value_seq()
+{
+    struct value *v = value_new();
+    v->type = SEQ_VAL;
+    v->data.seq_val = list_new();
+    return COL_VALUE(v);
+}
+
+// Appends a value to a sequence, takes ownership of element
+void col_seq_push(struct col_value *seq, struct col_value *element)
+{
+    list_push_back(VALUE(seq)->data.seq_val, VALUE(element));
+}
+
+// Reads a value written as a col constant, returns NULL on error
+struct col_value *col_value_parse(const char *text)
+{
+    struct lexer_state *lexer = lexer_new();
+    struct value *value = NULL;
+
+    lexer_init(lexer, text, strlen(text));
+    value = parse_constant(lexer, 0);
+
+    // Anything after the constant is an error
+    if(value)
+    {
+        lex(lexer);
+        if(lexer->error != END_OF_INPUT)
+        {
+            value_delete(value);
+            value = NULL;
+        }
+    }
+
+    lexer_delete(lexer);
+    return COL_VALUE(value);
+}
+
+// Writes a value as a col constant into a new string the caller must free
+char *col_value_serialize(struct col_value *value)
+{
+    struct buffer *out = buffer_new();
+    value_serialize(VALUE(value), out);
+    return buffer_release(out);
+}
+
+// Copies a value, including any sequence elements
+struct col_value *col_value_copy(struct col_value *value)
+{
+    return COL_VALUE(value_copy(VALUE(value)));
+}
+
+// Deletes a value
+void col_value_delete(struct col_value *value)
+{
+    value_delete(VALUE(value));
+}
+
+// Prints a text representation of a value
+void col_value_print(struct col_value *value)
+{
+    value_print(VALUE(value), 0);
+}
+
+enum col_value_type col_value_type(struct col_value *value)
+{
+    switch(VALUE(value)->type)
+    {
+    case INT_VAL:
+        return COL_INT;
+    case FLOAT_VAL:
+        return COL_FLOAT;
+    case CHAR_VAL:
+        return COL_CHAR;
+    case STRING_VAL:
+        return COL_STRING;
+    case BOOL_VAL:
+        return COL_BOOL;
+    case SEQ_VAL:
+        return COL_SEQ;
+    default:
+        return COL_BOTTOM;
+    }
+}
+
+int col_value_get_int(struct col_value *value)
+{
+    return VALUE(value)->data.int_val;
+}
+
+double col_value_get_float(struct col_value *value)
+{
+    return VALUE(value)->data.float_val;
+}
+
+char col_value_get_char(struct col_value *value)
+{
+    return VALUE(value)->data.char_val;
+}
+
+const char *col_value_get_string(struct col_value *value)
+{
+    return string_text(&VALUE(value)->data.str_val);
+}
+
+int col_value_get_bool(struct col_value *value)
+{
+    return VALUE(value)->data.bool_val;
+}
+
+// Returns the number of elements in a sequence
+int col_seq_length(struct col_value *seq)
+{
+    return VALUE(seq)->data.seq_val->count;
+}
+
+// Returns an element of a sequence, which remains owned by the sequence
+struct col_value *col_seq_get(struct col_value *seq, int element)
+{
+    return COL_VALUE(list_get(VALUE(seq)->data.seq_val, element));
+}
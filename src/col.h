@@ -0,0 +1,159 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef COL_H
+#define COL_H
+
+/**
+ * Public interface to libcol.  Everything an embedding program needs
+ * is declared in this file, the rest of the interpreter's symbols are
+ * hidden.  The structs are opaque, so their layout can change without
+ * breaking programs linked against the library.
+ *
+ * A program is loaded once with col_program_load, after which
+ * functions can be looked up by name and called any number of times.
+ * Loaded programs are never modified by calls, so a single program
+ * may be shared between threads.
+ */
+
+#include <stddef.h>
+
+#if defined(__GNUC__)
+#define COL_API __attribute__((visibility("default")))
+#else
+#define COL_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct col_program;
+struct col_function;
+struct col_value;
+
+// Value types as seen through the public interface
+enum col_value_type
+{
+    COL_INT,
+    COL_FLOAT,
+    COL_CHAR,
+    COL_STRING,
+    COL_BOOL,
+    COL_BOTTOM,
+    COL_SEQ
+};
+
+// When output from print and the like is written out
+enum col_flush_policy
+{
+    COL_FLUSH_DEFAULT, // After every line for terminals, else when full
+    COL_FLUSH_LINE,    // After every line
+    COL_FLUSH_BLOCK,   // Whenever the buffer fills
+    COL_FLUSH_EXIT     // Only at exit or on flush, the buffer grows to fit
+};
+
+// Loads a program from a source buffer, returns NULL on error
+COL_API struct col_program *col_program_load(const char *source,
+                                             size_t length);
+// Loads a program from a source file or image, returns NULL on error
+COL_API struct col_program *col_program_load_file(const char *path);
+// Compiles a source file into a program image, returns 0 on error
+COL_API int col_program_compile(const char *source_path,
+                                const char *image_path);
+// Deletes a program along with all of its functions
+COL_API void col_program_delete(struct col_program *program);
+// Prints a text representation of every function in a program
+COL_API void col_program_print(struct col_program *program);
+
+// Serves calls to a program's functions on a Unix domain socket, using
+// the given number of worker threads or one per processor if threads is
+// zero.  Returns only on error.
+COL_API int col_serve(struct col_program *program, const char *socket_path,
+                      int threads);
+
+// Sets the buffer size in bytes, or zero for the default, and the flush
+// policy of the output buffers for standard output and standard error
+COL_API void col_set_output(int size, enum col_flush_policy policy);
+// Writes out anything waiting in the output buffers
+COL_API void col_flush();
+
+// Sets whether programs loaded from now on evaluate the elements of
+// construct only when a primitive needs them.  Only elements that can't
+// perform I/O are deferred, and a warning is printed for the rest.  An
+// element that's never needed is never evaluated, so a program that would
+// otherwise return bottom because of it may return a value instead.
+COL_API void col_set_lazy(int lazy);
+
+// Sets how much memory in megabytes each thread may use for the stack of
+// deep recursion, or zero for the default of 256.  It's rounded up to a
+// multiple of 32 and can be no more than 4096.  Recursion deeper than this
+// allows prints an error and returns bottom.
+COL_API void col_set_stack_limit(int megabytes);
+
+// Finds a function by name, returns NULL if it isn't defined
+COL_API struct col_function *col_program_find(struct col_program *program,
+                                              const char *name);
+// Calls a function, takes ownership of in and returns a new value.  Lazy
+// streams are drained into a sequence and deferred construct elements are
+// evaluated before they're returned.
+COL_API struct col_value *col_call(struct col_function *function,
+                                   struct col_value *in);
+
+// Value constructors, each returns a new value owned by the caller
+COL_API struct col_value *col_value_int(int i);
+COL_API struct col_value *col_value_float(double f);
+COL_API struct col_value *col_value_char(char c);
+COL_API struct col_value *col_value_string(const char *s);
+COL_API struct col_value *col_value_bool(int b);
+COL_API struct col_value *col_value_bottom();
+COL_API struct col_value *col_value_seq();
+// Appends a value to a sequence, takes ownership of element
+COL_API void col_seq_push(struct col_value *seq, struct col_value *element);
+
+// Reads a value written as a col constant, returns NULL on error
+COL_API struct col_value *col_value_parse(const char *text);
+// Writes a value as a col constant into a new string the caller must free
+COL_API char *col_value_serialize(struct col_value *value);
+
+// Copies a value, including any sequence elements
+COL_API struct col_value *col_value_copy(struct col_value *value);
+// Deletes a value
+COL_API void col_value_delete(struct col_value *value);
+// Prints a text representation of a value
+COL_API void col_value_print(struct col_value *value);
+
+// Value accessors, results are unspecified if the type doesn't match
+COL_API enum col_value_type col_value_type(struct col_value *value);
+COL_API int col_value_get_int(struct col_value *value);
+COL_API double col_value_get_float(struct col_value *value);
+COL_API char col_value_get_char(struct col_value *value);
+COL_API const char *col_value_get_string(struct col_value *value);
+COL_API int col_value_get_bool(struct col_value *value);
+// Returns the number of elements in a sequence
+COL_API int col_seq_length(struct col_value *seq);
+// Returns an element of a sequence, which remains owned by the sequence
+COL_API struct col_value *col_seq_get(struct col_value *seq, int element);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COL_H
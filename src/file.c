@@ -18,44 +18,114 @@
  *
  **/
 
-#include <stdio.h>
+
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "file.h"
 
 #define BUFFER_STARTSIZE (1024 * 100)
 
-// Reads a file into a string buffer
-char *read_file(const char *file)
+// Reads everything remaining on a descriptor into a heap buffer
+int read_stream(int fd, struct file_data *file);
+
+// Reads a file into memory, or standard input if the name is "-"
+struct file_data *read_file(const char *file)
 {
-    int bufsize = BUFFER_STARTSIZE;
-    int chars_read = 0;
-    char *buffer = (char*)calloc(bufsize, sizeof(char));
-    FILE *fin = fopen(file, "r");
-    int cin = 0;
+    int fd;
+    struct stat st;
+    struct file_data *retval =
+        (struct file_data*)malloc(sizeof(struct file_data));
+
+    retval->data = NULL;
+    retval->length = 0;
+    retval->mapped = 0;
+
+    if(!strcmp(file, "-"))
+        fd = STDIN_FILENO;
+    else
+        fd = open(file, O_RDONLY);
 
-    if(!fin)
+    if(fd < 0 || fstat(fd, &st) < 0)
+    {
+        if(fd > STDIN_FILENO)
+            close(fd);
+        free(retval);
         return NULL;
-    
-    while(!feof(fin))
+    }
+
+    // Regular files are mapped whole, anything else (pipes, terminals,
+    // empty files) is read until it runs out
+    if(S_ISREG(st.st_mode) && st.st_size > 0)
     {
-        cin = fgetc(fin);
-
-        if(cin == EOF)
-            break;
-        
-        buffer[chars_read] = cin;
-        chars_read++;
-        
-        if(chars_read >= bufsize - 1)
+        retval->data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(retval->data != MAP_FAILED)
+        {
+            retval->length = st.st_size;
+            retval->mapped = 1;
+        }
+        else
+        {
+            retval->data = NULL;
+        }
+    }
+
+    if(!retval->mapped && !read_stream(fd, retval))
+    {
+        free(retval->data);
+        free(retval);
+        retval = NULL;
+    }
+
+    if(fd != STDIN_FILENO)
+        close(fd);
+    return retval;
+}
+
+// Releases the memory holding a file
+void file_data_delete(struct file_data *file)
+{
+    if(!file)
+        return;
+
+    if(file->mapped)
+        munmap(file->data, file->length);
+    else
+        free(file->data);
+    free(file);
+}
+
+// Reads everything remaining on a descriptor into a heap buffer
+int read_stream(int fd, struct file_data *file)
+{
+    size_t bufsize = BUFFER_STARTSIZE;
+    ssize_t n;
+
+    file->data = (char*)malloc(bufsize);
+    file->length = 0;
+
+    while(1)
+    {
+        n = read(fd, file->data + file->length, bufsize - file->length);
+
+        if(n == 0)
+            return 1;
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            return 0;
+
+        file->length += n;
+        if(file->length == bufsize)
         {
             // Doubling the buffer size if it's filled up
             bufsize *= 2;
-            buffer = realloc(buffer, bufsize);
-            memset(buffer + chars_read + 1, 0, bufsize / 2);
+            file->data = (char*)realloc(file->data, bufsize);
         }
     }
-
-    return buffer;
 }
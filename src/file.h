@@ -18,10 +18,24 @@
  *
  **/
 
+
 #ifndef FILE_H
 #define FILE_H
 
-// Reads a file into a string buffer
-char *read_file(const char *file);
+#include <stddef.h>
+
+// The contents of a file loaded into memory
+struct file_data
+{
+    char *data;
+    size_t length;
+    // Non-zero if data is a read-only mapping rather than a heap buffer
+    int mapped;
+};
+
+// Reads a file into memory, or standard input if the name is "-"
+struct file_data *read_file(const char *file);
+// Releases the memory holding a file
+void file_data_delete(struct file_data *file);
 
 #endif // FILE_H
@@ -0,0 +1,420 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <string.h>
+#include <stdint.h>
+
+#include "format.h"
+
+/**
+ * Floats are converted with the Ryu algorithm (Ulf Adams, "Ryu: Fast
+ * Float-to-String Conversion", PLDI 2018).  The float's neighbours bound
+ * an interval of decimals that read back as the same float.  The
+ * interval's ends are scaled by a power of ten using the tables below, and
+ * then digits are removed until the shortest decimal left in the interval
+ * is found.  That decimal is the closest to the float of all the
+ * shortest ones.
+ */
+
+#define FLOAT_MANTISSA_BITS 23
+#define FLOAT_EXPONENT_BITS 8
+#define FLOAT_BIAS 127
+#define FLOAT_POW5_INV_BITCOUNT 59
+#define FLOAT_POW5_BITCOUNT 61
+
+// Two digit decimal representations of 0-99
+const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// floor(2^(bits(5^i) - 1 + FLOAT_POW5_INV_BITCOUNT) / 5^i) + 1
+const uint64_t FLOAT_POW5_INV_SPLIT[31] =
+{
+    576460752303423489ULL, 461168601842738791ULL, 368934881474191033ULL,
+    295147905179352826ULL, 472236648286964522ULL, 377789318629571618ULL,
+    302231454903657294ULL, 483570327845851670ULL, 386856262276681336ULL,
+    309485009821345069ULL, 495176015714152110ULL, 396140812571321688ULL,
+    316912650057057351ULL, 507060240091291761ULL, 405648192073033409ULL,
+    324518553658426727ULL, 519229685853482763ULL, 415383748682786211ULL,
+    332306998946228969ULL, 531691198313966350ULL, 425352958651173080ULL,
+    340282366920938464ULL, 544451787073501542ULL, 435561429658801234ULL,
+    348449143727040987ULL, 557518629963265579ULL, 446014903970612463ULL,
+    356811923176489971ULL, 570899077082383953ULL, 456719261665907162ULL,
+    365375409332725730ULL
+};
+
+// 5^i scaled to FLOAT_POW5_BITCOUNT bits
+const uint64_t FLOAT_POW5_SPLIT[48] =
+{
+    1152921504606846976ULL, 1441151880758558720ULL, 1801439850948198400ULL,
+    2251799813685248000ULL, 1407374883553280000ULL, 1759218604441600000ULL,
+    2199023255552000000ULL, 1374389534720000000ULL, 1717986918400000000ULL,
+    2147483648000000000ULL, 1342177280000000000ULL, 1677721600000000000ULL,
+    2097152000000000000ULL, 1310720000000000000ULL, 1638400000000000000ULL,
+    2048000000000000000ULL, 1280000000000000000ULL, 1600000000000000000ULL,
+    2000000000000000000ULL, 1250000000000000000ULL, 1562500000000000000ULL,
+    1953125000000000000ULL, 1220703125000000000ULL, 1525878906250000000ULL,
+    1907348632812500000ULL, 1192092895507812500ULL, 1490116119384765625ULL,
+    1862645149230957031ULL, 1164153218269348144ULL, 1455191522836685180ULL,
+    1818989403545856475ULL, 2273736754432320594ULL, 1421085471520200371ULL,
+    1776356839400250464ULL, 2220446049250313080ULL, 1387778780781445675ULL,
+    1734723475976807094ULL, 2168404344971008868ULL, 1355252715606880542ULL,
+    1694065894508600678ULL, 2117582368135750847ULL, 1323488980084844279ULL,
+    1654361225106055349ULL, 2067951531382569187ULL, 1292469707114105741ULL,
+    1615587133892632177ULL, 2019483917365790221ULL, 1262177448353618888ULL
+};
+
+// Writes an unsigned number's digits ending just before end, returns a
+// pointer to the first digit
+char *format_digits(char *end, uint32_t n);
+// Finds the shortest decimal that reads back as the float with the given
+// IEEE exponent and mantissa, as digits * 10^exponent
+void format_shortest(uint32_t ieee_mantissa, uint32_t ieee_exponent,
+                     uint32_t *digits, int *exponent);
+
+// Fixed-point helpers for the conversion
+uint32_t pow5_bits(int e);
+uint32_t log10_pow2(int e);
+uint32_t log10_pow5(int e);
+int multiple_of_pow5(uint32_t n, uint32_t p);
+int multiple_of_pow2(uint32_t n, uint32_t p);
+uint32_t mul_shift(uint32_t m, uint64_t factor, int shift);
+
+// Writes an integer in decimal, returns the number of characters written
+int format_int(char *buf, int n)
+{
+    char tmp[FORMAT_INT_SIZE];
+    char *end = tmp + FORMAT_INT_SIZE;
+    char *start = NULL;
+    int length;
+
+    // Negating as unsigned, so that INT_MIN doesn't overflow
+    start = format_digits(end, n < 0 ? 0U - (uint32_t)n : (uint32_t)n);
+    if(n < 0)
+        *(--start) = '-';
+
+    length = end - start;
+    memcpy(buf, start, length);
+    buf[length] = '\0';
+    return length;
+}
+
+// Writes the shortest decimal that reads back as the same float, always
+// with a decimal point so that it also reads back as a float.  Returns the
+// number of characters written.
+int format_float(char *buf, float f)
+{
+    uint32_t bits;
+    uint32_t ieee_mantissa, ieee_exponent;
+    uint32_t digits;
+    int exponent, point, count;
+    char tmp[FORMAT_INT_SIZE];
+    char *end = tmp + FORMAT_INT_SIZE;
+    char *start = NULL;
+    char *c = buf;
+
+    memcpy(&bits, &f, sizeof(bits));
+    ieee_mantissa = bits & ((1U << FLOAT_MANTISSA_BITS) - 1);
+    ieee_exponent = (bits >> FLOAT_MANTISSA_BITS)
+        & ((1U << FLOAT_EXPONENT_BITS) - 1);
+
+    if(bits >> 31)
+        *(c++) = '-';
+
+    // Infinity, NaN, and zero have no digits to find
+    if(ieee_exponent == (1U << FLOAT_EXPONENT_BITS) - 1)
+    {
+        strcpy(c, ieee_mantissa ? "nan" : "inf");
+        return c + 3 - buf;
+    }
+    if(!ieee_exponent && !ieee_mantissa)
+    {
+        strcpy(c, "0.0");
+        return c + 3 - buf;
+    }
+
+    format_shortest(ieee_mantissa, ieee_exponent, &digits, &exponent);
+    start = format_digits(end, digits);
+    count = end - start;
+
+    // Position of the decimal point relative to the first digit
+    point = count + exponent;
+
+    if(point > FORMAT_PLAIN_LIMIT)
+    {
+        // Large numbers in scientific notation, d.ddde21
+        *(c++) = *(start++);
+        *(c++) = '.';
+        if(start == end)
+            *(c++) = '0';
+        while(start < end)
+            *(c++) = *(start++);
+        *(c++) = 'e';
+        c += format_int(c, point - 1);
+    }
+    else if(point <= 0)
+    {
+        // Small numbers as 0.000ddd
+        *(c++) = '0';
+        *(c++) = '.';
+        for(; point < 0; point++)
+            *(c++) = '0';
+        while(start < end)
+            *(c++) = *(start++);
+    }
+    else
+    {
+        // Everything else as ddd.ddd, or ddd00.0
+        for(; point > 0 && start < end; point--)
+            *(c++) = *(start++);
+        for(; point > 0; point--)
+            *(c++) = '0';
+        *(c++) = '.';
+        if(start == end)
+            *(c++) = '0';
+        while(start < end)
+            *(c++) = *(start++);
+    }
+
+    *c = '\0';
+    return c - buf;
+}
+
+// Writes an unsigned number's digits ending just before end, returns a
+// pointer to the first digit
+char *format_digits(char *end, uint32_t n)
+{
+    while(n >= 100)
+    {
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + (n % 100) * 2, 2);
+        n /= 100;
+    }
+
+    if(n >= 10)
+    {
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + n * 2, 2);
+    }
+    else
+    {
+        *(--end) = '0' + n;
+    }
+
+    return end;
+}
+
+// Finds the shortest decimal that reads back as the float with the given
+// IEEE exponent and mantissa, as digits * 10^exponent
+void format_shortest(uint32_t ieee_mantissa, uint32_t ieee_exponent,
+                     uint32_t *digits, int *exponent)
+{
+    int e2, e10, q, i, j, k, l;
+    uint32_t m2, mv, mp, mm, mm_shift;
+    uint32_t vr, vp, vm;
+    int accept_bounds;
+    int vm_trailing_zeros = 0, vr_trailing_zeros = 0;
+    int last_removed_digit = 0;
+    int removed = 0;
+
+    if(ieee_exponent == 0)
+    {
+        e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = ieee_mantissa;
+    }
+    else
+    {
+        e2 = (int)ieee_exponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+        m2 = (1U << FLOAT_MANTISSA_BITS) | ieee_mantissa;
+    }
+
+    // The interval of decimals that round to this float, scaled by four
+    // so its ends are integers.  The bounds themselves round to even.
+    accept_bounds = (m2 & 1) == 0;
+    mv = 4 * m2;
+    mp = 4 * m2 + 2;
+    mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    mm = 4 * m2 - 1 - mm_shift;
+
+    // Scaling the interval to decimal, tracking whether any digits
+    // dropped along the way were all zeros
+    if(e2 >= 0)
+    {
+        q = log10_pow2(e2);
+        e10 = q;
+        k = FLOAT_POW5_INV_BITCOUNT + pow5_bits(q) - 1;
+        i = -e2 + q + k;
+        vr = mul_shift(mv, FLOAT_POW5_INV_SPLIT[q], i);
+        vp = mul_shift(mp, FLOAT_POW5_INV_SPLIT[q], i);
+        vm = mul_shift(mm, FLOAT_POW5_INV_SPLIT[q], i);
+
+        if(q != 0 && (vp - 1) / 10 <= vm / 10)
+        {
+            l = FLOAT_POW5_INV_BITCOUNT + pow5_bits(q - 1) - 1;
+            last_removed_digit =
+                mul_shift(mv, FLOAT_POW5_INV_SPLIT[q - 1], -e2 + q - 1 + l)
+                % 10;
+        }
+
+        if(q <= 9)
+        {
+            if(mv % 5 == 0)
+                vr_trailing_zeros = multiple_of_pow5(mv, q);
+            else if(accept_bounds)
+                vm_trailing_zeros = multiple_of_pow5(mm, q);
+            else
+                vp -= multiple_of_pow5(mp, q);
+        }
+    }
+    else
+    {
+        q = log10_pow5(-e2);
+        e10 = q + e2;
+        i = -e2 - q;
+        k = pow5_bits(i) - FLOAT_POW5_BITCOUNT;
+        j = q - k;
+        vr = mul_shift(mv, FLOAT_POW5_SPLIT[i], j);
+        vp = mul_shift(mp, FLOAT_POW5_SPLIT[i], j);
+        vm = mul_shift(mm, FLOAT_POW5_SPLIT[i], j);
+
+        if(q != 0 && (vp - 1) / 10 <= vm / 10)
+        {
+            j = q - 1 - (pow5_bits(i + 1) - FLOAT_POW5_BITCOUNT);
+            last_removed_digit =
+                mul_shift(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10;
+        }
+
+        if(q <= 1)
+        {
+            vr_trailing_zeros = 1;
+            if(accept_bounds)
+                vm_trailing_zeros = mm_shift == 1;
+            else
+                vp--;
+        }
+        else if(q < 31)
+        {
+            vr_trailing_zeros = multiple_of_pow2(mv, q - 1);
+        }
+    }
+
+    // Removing digits while the interval still holds a shorter decimal
+    if(vm_trailing_zeros || vr_trailing_zeros)
+    {
+        // The general case, which can't happen often
+        while(vp / 10 > vm / 10)
+        {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed_digit == 0;
+            last_removed_digit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+
+        if(vm_trailing_zeros)
+        {
+            while(vm % 10 == 0)
+            {
+                vr_trailing_zeros &= last_removed_digit == 0;
+                last_removed_digit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+
+        // Exactly halfway rounds to even
+        if(vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+            last_removed_digit = 4;
+
+        *digits = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros))
+                        || last_removed_digit >= 5);
+    }
+    else
+    {
+        // The common case
+        while(vp / 10 > vm / 10)
+        {
+            last_removed_digit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+
+        *digits = vr + (vr == vm || last_removed_digit >= 5);
+    }
+
+    *exponent = e10 + removed;
+}
+
+// Number of bits in 5^e, or 1 for e = 0
+uint32_t pow5_bits(int e)
+{
+    return (((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e))
+uint32_t log10_pow2(int e)
+{
+    return ((uint32_t)e * 78913) >> 18;
+}
+
+// floor(log10(5^e))
+uint32_t log10_pow5(int e)
+{
+    return ((uint32_t)e * 732923) >> 20;
+}
+
+// Checks whether n is divisible by 5^p
+int multiple_of_pow5(uint32_t n, uint32_t p)
+{
+    uint32_t count = 0;
+
+    while(n % 5 == 0)
+    {
+        n /= 5;
+        count++;
+    }
+
+    return count >= p;
+}
+
+// Checks whether n is divisible by 2^p
+int multiple_of_pow2(uint32_t n, uint32_t p)
+{
+    return (n & ((1U << p) - 1)) == 0;
+}
+
+// Returns (m * factor) >> shift, for shifts of more than 32
+uint32_t mul_shift(uint32_t m, uint64_t factor, int shift)
+{
+    uint64_t low = (uint64_t)m * (uint32_t)factor;
+    uint64_t high = (uint64_t)m * (uint32_t)(factor >> 32);
+
+    return ((low >> 32) + high) >> (shift - 32);
+}
@@ -0,0 +1,36 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#define FORMAT_INT_SIZE 12   // Enough for any int and a terminator
+#define FORMAT_FLOAT_SIZE 56 // Enough for any float and a terminator
+#define FORMAT_PLAIN_LIMIT 21 // Floats from 1e21 up are written as 1.0e21
+
+// Writes an integer in decimal, returns the number of characters written
+int format_int(char *buf, int n);
+// Writes the shortest decimal that reads back as the same float, always
+// with a decimal point so that it also reads back as a float.  Returns the
+// number of characters written.
+int format_float(char *buf, float f);
+
+#endif // FORMAT_H
@@ -19,10 +19,66 @@
  **/
 
 #include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "forms.h"
 #include "list.h"
 #include "interpreter.h"
+#include "primitives.h"
+#include "format.h"
+#include "stream.h"
+#include "optimizer.h"
+#include "sort.h"
+
+// A share of pfilter's work, tested on its own thread
+struct filter_chunk
+{
+    struct function *predicate;
+    struct list_node *front;
+    int count;
+    char *keep;
+    // Cleared if the predicate gave anything other than a boolean
+    int valid;
+};
+
+// Applies str to each element of a sequence, converting numbers in place
+struct value *map_to_string(struct function *f, struct value *in);
+// Tests one chunk of pfilter's input, run on a worker thread
+void *filter_chunk_test(void *arg);
+// Checks whether a value holds any streams, thunks, arrays or maps, which
+// can be shared between copies and so can't be copied on more than one
+// thread at once
+int filter_shared(struct value *value);
+// Checks for the single function argument and < init, list > input of a
+// fold, forcing the list if it was deferred
+int fold_input(struct list *args, struct value *in);
+// Takes the list out of the input of a fold, once its initial value has
+// been taken, and deletes what's left
+struct value *fold_list(struct value *in);
+// Reduces a sequence or stream with f, applying map to each element first
+// unless it's NULL
+struct value *reduce_mapped(struct function *f, struct function *map,
+                            struct value *in);
+// Folds the elements of a sequence or stream onto out from the left,
+// taking ownership of both, applying map to each element first unless it's
+// NULL
+struct value *fold_left(struct function *f, struct function *map,
+                        struct value *out, struct value *in);
+// Takes the next element of a sequence or stream, applying map to it
+// unless it's NULL, returns NULL once there are none left
+struct value *fold_next(struct function *map, struct value *in);
+// Applies f to a pair of two values, taking ownership of them, reusing
+// pair if f is a primitive
+struct value *fold_apply(struct function *f, struct value *pair,
+                         struct value *a, struct value *b);
+// Creates a pair from two values, taking ownership of them
+struct value *pair_new(struct value *a, struct value *b);
+// Frees a pair without its elements
+void pair_free(struct value *pair);
+// Runs a conditional marked FUNCTION_CONS as a loop, collecting each
+// level's element in one sequence instead of recursing and copying
+struct value *iff_cons(struct function *function, struct value *in);
 
 /*** compose
  * Function composition.  Feeds its input to the last function in its argument
@@ -34,22 +90,27 @@
  */
 struct value *compose(struct list *args, struct value *in)
 {
-    struct value *current = in;
-    struct value *last = in;
-    struct function *f = NULL;
-    struct cursor *c = NULL;
+    struct function *f = compose_tail(args, &in);
+
+    return f ? function_exec(f, in) : in;
+}
+
+// Runs every function of a composition but the outermost, replacing *in
+// with the result, and returns the outermost function for the caller to
+// run in tail position, or NULL if there are no functions
+struct function *compose_tail(struct list *args, struct value **in)
+{
+    struct list_node *node = NULL;
+
+    if(!args || !args->front)
+        return NULL;
 
     // Stepping backwards through the list of arguments and feeding
     // input to successive functions, deleting intermediate values
-    for(c = cursor_new_back(args); cursor_valid(c); cursor_prev(c))
-    {
-        f = cursor_get(c);
-        last = current;
-        current = function_exec(f, current);
-    }
-    cursor_delete(c);
+    for(node = args->back; node != args->front; node = node->prev)
+        *in = function_exec((struct function*)node->data, *in);
 
-    return current;
+    return (struct function*)args->front->data;
 }
 
 /*** construct
@@ -58,22 +119,33 @@ struct value *compose(struct list *args, struct value *in)
  * argument functions.
  *
  * construct{ f, g } : x  = < f : x, g : x >
+ *
+ * With lazy evaluation on, elements that don't perform I/O are evaluated
+ * only when a primitive needs them.
  */
 struct value *construct(struct list *args, struct value *in)
 {
     struct value *out = value_new();
-    struct cursor *c = NULL;
+    struct value *element = NULL;
+    struct function *f = NULL;
+    struct list_node *node = NULL;
 
     out->type = SEQ_VAL;
     out->data.seq_val = list_new();
 
-    for(c = cursor_new_front(args); cursor_valid(c); cursor_next(c))
+    for(node = args->front; node; node = node->next)
     {
-        list_push_back(out->data.seq_val,
-                       function_exec(cursor_get(c), value_copy(in)));
+        f = node->data;
+
+        // Deferred elements are only evaluated once they're needed
+        if((f->flags & FUNCTION_DEFER) && in->type != STREAM_VAL)
+            element = thunk_new(f, value_copy(in));
+        else
+            element = stream_materialize(function_exec(f, value_copy(in)));
+
+        list_push_back(out->data.seq_val, element);
     }
     value_delete(in);
-    cursor_delete(c);
     return out;
 }
 
@@ -87,38 +159,177 @@ struct value *construct(struct list *args, struct value *in)
  */
 struct value *iff(struct list *args, struct value *in)
 {
-    struct value *test = value_copy(in);
-    struct value *out = NULL;
+    struct function *branch = iff_tail(args, &in);
 
-    // Checking for correct number of arguments
-    if(args->count != 3)
+    return branch ? function_exec(branch, in) : value_new();
+}
+
+// Runs the test of a conditional and returns the branch it selects, for
+// the caller to run in tail position on *in.  Returns NULL, with *in
+// deleted, if the test doesn't produce a boolean.
+struct function *iff_tail(struct list *args, struct value **in)
+{
+    struct value *test = NULL;
+    struct function *branch = NULL;
+
+    // Checking for correct number of arguments, then testing input with
+    // the first argument
+    if(args && args->count == 3)
     {
+        test = function_exec(list_get(args, 0), value_copy(*in));
+        if(test->type == BOOL_VAL)
+            branch = list_get(args, test->data.bool_val ? 1 : 2);
         value_delete(test);
-        value_delete(in);
-        return value_new();
     }
 
-    // Testing input with first argument
-    test = function_exec(list_get(args, 0), test);
+    if(!branch)
+    {
+        value_delete(*in);
+        *in = NULL;
+    }
 
-    if(test->type == BOOL_VAL)
+    return branch;
+}
+
+// Checks whether a conditional is the whole definition of a function, one
+// of whose branches prepends or appends an element onto the result of
+// calling that function again, as in
+//
+//   f = if{ p, g, compose{ prepend, construct{ h, compose{ f, k } } } }
+//
+// Returns the number of that branch, 1 or 2, or 0 if there isn't one
+int iff_cons_branch(struct function *function)
+{
+    struct function *branch = NULL;
+    struct function *cons = NULL;
+    struct function *pair = NULL;
+    struct function *self = NULL;
+    int i;
+
+    if(!function->args || function->args->count != 3)
+        return 0;
+
+    for(i = 1; i <= 2; i++)
     {
-        if(test->data.bool_val)
+        branch = list_get(function->args, i);
+        if(branch->type != FORM || FUNCTIONAL_FORMS[branch->index] != compose
+           || !branch->args || branch->args->count < 2)
+            continue;
+
+        cons = list_get(branch->args, 0);
+        pair = list_get(branch->args, 1);
+        if(cons->type != PRIMITIVE || cons->args
+           || (PRIMITIVE_FUNCTIONS[cons->index] != prepend
+               && PRIMITIVE_FUNCTIONS[cons->index] != append))
+            continue;
+
+        if(pair->type != FORM || FUNCTIONAL_FORMS[pair->index] != construct
+           || !pair->args || pair->args->count != 2)
+            continue;
+
+        // The second element must be the recursive call, possibly after
+        // some steps of its own
+        self = list_get(pair->args, 1);
+        if(self->type == FORM && FUNCTIONAL_FORMS[self->index] == compose
+           && self->args && self->args->count > 0)
+            self = list_get(self->args, 0);
+
+        if(self->type == USER && self->definition == function)
+            return i;
+    }
+
+    return 0;
+}
+
+// Runs a conditional marked FUNCTION_CONS as a loop, collecting each
+// level's element in one sequence instead of recursing and copying
+struct value *iff_cons(struct function *function, struct value *in)
+{
+    int recursive = iff_cons_branch(function);
+    struct function *test = list_get(function->args, 0);
+    struct function *base = list_get(function->args, 3 - recursive);
+    struct function *branch = list_get(function->args, recursive);
+    struct list_node *pair_node = branch->args->front->next;
+    struct function *pair = pair_node->data;
+    struct function *element = list_get(pair->args, 0);
+    struct function *self = list_get(pair->args, 1);
+    int append_mode = PRIMITIVE_FUNCTIONS[
+        ((struct function*)branch->args->front->data)->index] == append;
+    struct list *elements = list_new();
+    struct list_node *node = NULL;
+    struct value *t = NULL;
+    struct value *x = NULL;
+    struct value *out = NULL;
+
+    for(;;)
+    {
+        // Each level's test decides whether to recurse again
+        t = function_exec(test, value_copy(in));
+        if(t->type != BOOL_VAL)
+            break;
+        if((t->data.bool_val ? 1 : 2) != recursive)
         {
-            value_delete(test);
-            return function_exec(list_get(args, 1), in);
+            value_delete(t);
+            t = NULL;
+            out = stream_materialize(function_exec(base, in));
+            in = NULL;
+
+            // Elements get consed onto the innermost result directly, so
+            // it can't be left as a stream or a thunk
+            if(out->type == THUNK_VAL)
+                value_force(out, 0);
+            break;
         }
-        else
+        value_delete(t);
+        t = NULL;
+
+        // Functions run before the pair is constructed
+        for(node = branch->args->back; node != pair_node; node = node->prev)
+            in = function_exec((struct function*)node->data, in);
+
+        x = function_exec(element, value_copy(in));
+        if(value_is_bottom(x))
         {
-            value_delete(test);
-            return function_exec(list_get(args, 2), in);
+            value_delete(x);
+            break;
         }
+        list_push_back(elements, x);
+
+        // The recursive call's own steps give the next level's input
+        if(self->type == FORM)
+            compose_tail(self->args, &in);
     }
-    else
-    {
+
+    if(t)
+        value_delete(t);
+    if(in)
         value_delete(in);
+
+    // Anything that would have made a level bottom makes the whole thing
+    // bottom, and the innermost result has to be a sequence to cons onto
+    if(!out || out->type != SEQ_VAL)
+    {
+        while(elements->count)
+            value_delete(list_pop(elements));
+        list_delete(elements);
+        if(out)
+            value_delete(out);
         return value_new();
     }
+
+    // prepend gives the elements in order before the innermost result,
+    // append gives them in reverse after it
+    while(elements->count)
+    {
+        x = list_pop_back(elements);
+        if(append_mode)
+            list_push_back(out->data.seq_val, x);
+        else
+            list_push(out->data.seq_val, x);
+    }
+    list_delete(elements);
+
+    return out;
 }
 
 /*** map
@@ -127,37 +338,350 @@ struct value *iff(struct list *args, struct value *in)
  * the result of applying the argument function to each element in the list.
  *
  * map{ f } : < x, y, z > = < f : x, f : y, f : z >
+ *
+ * Mapping over a stream produces another stream, which applies f to each
+ * element only as it's pulled.
  */
 struct value *map(struct list *args, struct value *in)
 {
-
-    struct value *out = NULL;
     struct function *f = list_get(args, 0);
-    struct list *l = NULL;
-    struct cursor *c;
+    struct list_node *node = NULL;
 
     // First ensure valid input
-    if(args->count != 1 || in->type != SEQ_VAL)
+    if(args->count != 1 || (in->type != SEQ_VAL && in->type != STREAM_VAL))
     {
         value_delete(in);
         return value_new();
     }
 
-    // Otherwise create an output list by applying f to each element of in
-    out = value_new();
-    out->type = SEQ_VAL;
-    out->data.seq_val = list_new();
+    if(in->type == STREAM_VAL)
+        return stream_map(in, f);
 
-    l = in->data.seq_val;
+    // Converting numbers to strings is common enough to do in bulk
+    if(f->type == PRIMITIVE && PRIMITIVE_FUNCTIONS[f->index] == to_string)
+        return map_to_string(f, in);
 
-    for(c = cursor_new_front(l); cursor_valid(c); cursor_next(c))
-        list_push_back(out->data.seq_val,
-                       function_exec(f, value_copy(cursor_get(c))));
+    // Otherwise apply f to each element of in, which is ours to consume,
+    // leaving each result in the place of its input
+    for(node = in->data.seq_val->front; node; node = node->next)
+        node->data = stream_materialize(function_exec(f, node->data));
 
-    value_delete(in);
-    cursor_delete(c);
-    return out;
+    return in;
+}
+
+// Applies str to each element of a sequence, converting numbers in place
+struct value *map_to_string(struct function *f, struct value *in)
+{
+    char buf[FORMAT_FLOAT_SIZE];
+    int length;
+    struct value *v = NULL;
+    struct list_node *node = NULL;
+
+    for(node = in->data.seq_val->front; node; node = node->next)
+    {
+        v = (struct value*)node->data;
+
+        // Anything else goes through str as usual
+        if(v->type != INT_VAL && v->type != FLOAT_VAL)
+        {
+            node->data = function_exec(f, v);
+            continue;
+        }
+
+        if(v->type == INT_VAL)
+            length = format_int(buf, v->data.int_val);
+        else
+            length = format_float(buf, v->data.float_val);
+
+        v->type = STRING_VAL;
+        string_init(&v->data.str_val, buf, length);
+    }
+
+    return in;
+}
+
+/*** filter
+ * Filtering functional form.  Accepts a single predicate argument.  Input
+ * should be a list, and the return value is the list of those elements for
+ * which the predicate returns True, in their original order.  Returns Bottom
+ * if the predicate returns anything other than a boolean.
+ *
+ * filter{ p } : < x, y, z > = < x, z > if p : x and p : z are True, and
+ * p : y is False
+ *
+ * Filtering a stream produces another stream, which tests each element
+ * only as it's pulled.
+ */
+struct value *filter(struct list *args, struct value *in)
+{
+    struct function *p = list_get(args, 0);
+    struct list_node *node = NULL;
+    struct list_node *next = NULL;
+    struct value *test = NULL;
+    int keep;
+
+    if(args->count != 1 || (in->type != SEQ_VAL && in->type != STREAM_VAL))
+    {
+        value_delete(in);
+        return value_new();
+    }
+
+    if(in->type == STREAM_VAL)
+        return stream_filter(in, p);
+
+    // Rejected elements are unlinked from the input, which becomes the
+    // output, so the kept ones never move
+    for(node = in->data.seq_val->front; node; node = next)
+    {
+        next = node->next;
+        test = function_exec(p, value_copy(node->data));
+        if(test->type != BOOL_VAL)
+        {
+            value_delete(test);
+            value_delete(in);
+            return value_new();
+        }
+
+        keep = test->data.bool_val;
+        value_delete(test);
+        if(!keep)
+        {
+            value_delete(node->data);
+            list_remove_node(in->data.seq_val, node);
+        }
+    }
+
+    return in;
+}
+
+/*** pfilter
+ * Parallel filtering functional form.  The same as filter, except that the
+ * input list is split into chunks, one for each processor, and the
+ * predicate is applied to each chunk on its own thread.  Falls back to
+ * filter for short lists, predicates that perform I/O, and lists holding
+ * streams, arrays, maps or deferred elements.
+ *
+ * pfilter{ p } : < x, y, z > = filter{ p } : < x, y, z >
+ */
+struct value *pfilter(struct list *args, struct value *in)
+{
+    struct function *p = list_get(args, 0);
+    struct filter_chunk *chunks = NULL;
+    pthread_t *threads = NULL;
+    struct list_node *node = NULL;
+    struct list_node *next = NULL;
+    char *keep = NULL;
+    int count;
+    int valid = 1;
+    int i, j, k;
+
+    if(args->count != 1 || in->type != SEQ_VAL
+       || (p->flags & FUNCTION_IMPURE) || OPTIMIZER_DEFERS
+       || filter_shared(in))
+    {
+        return filter(args, in);
+    }
+
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    if(count > in->data.seq_val->count / PFILTER_CHUNK_MIN)
+        count = in->data.seq_val->count / PFILTER_CHUNK_MIN;
+    if(count < 2)
+        return filter(args, in);
+
+    // Splitting the input into nearly equal chunks, each with its own
+    // stretch of the keep flags
+    keep = (char*)malloc(in->data.seq_val->count);
+    chunks = (struct filter_chunk*)malloc(count * sizeof(struct filter_chunk));
+    threads = (pthread_t*)malloc(count * sizeof(pthread_t));
+    node = in->data.seq_val->front;
+    for(i = 0, j = 0; i < count; i++)
+    {
+        chunks[i].predicate = p;
+        chunks[i].front = node;
+        chunks[i].count = in->data.seq_val->count / count
+            + (i < in->data.seq_val->count % count);
+        chunks[i].keep = keep + j;
+        chunks[i].valid = 1;
+
+        j += chunks[i].count;
+        for(k = 0; k < chunks[i].count; k++)
+            node = node->next;
+    }
+
+    // This thread takes the first chunk, and any a thread couldn't be
+    // started for
+    for(i = 1; i < count; i++)
+        if(pthread_create(&threads[i], NULL, filter_chunk_test, &chunks[i]))
+            chunks[i].predicate = NULL;
+    filter_chunk_test(&chunks[0]);
+
+    for(i = 1; i < count; i++)
+    {
+        if(chunks[i].predicate)
+            pthread_join(threads[i], NULL);
+        else
+        {
+            chunks[i].predicate = p;
+            filter_chunk_test(&chunks[i]);
+        }
+        valid &= chunks[i].valid;
+    }
+    valid &= chunks[0].valid;
+
+    // Unlinking rejected elements in a single pass
+    if(valid)
+    {
+        for(node = in->data.seq_val->front, i = 0; node; node = next, i++)
+        {
+            next = node->next;
+            if(!keep[i])
+            {
+                value_delete(node->data);
+                list_remove_node(in->data.seq_val, node);
+            }
+        }
+    }
+
+    free(threads);
+    free(chunks);
+    free(keep);
+
+    if(!valid)
+    {
+        value_delete(in);
+        return value_new();
+    }
+    return in;
+}
+
+// Tests one chunk of pfilter's input, run on a worker thread
+void *filter_chunk_test(void *arg)
+{
+    struct filter_chunk *chunk = (struct filter_chunk*)arg;
+    struct list_node *node = chunk->front;
+    struct value *test = NULL;
+    int i;
+
+    for(i = 0; i < chunk->count; i++, node = node->next)
+    {
+        test = function_exec(chunk->predicate, value_copy(node->data));
+        if(test->type != BOOL_VAL)
+        {
+            value_delete(test);
+            chunk->valid = 0;
+            break;
+        }
+
+        chunk->keep[i] = test->data.bool_val;
+        value_delete(test);
+    }
+
+    return NULL;
+}
+
+// Checks whether a value holds any streams, thunks, arrays or maps, which
+// can be shared between copies and so can't be copied on more than one
+// thread at once
+int filter_shared(struct value *value)
+{
+    struct list_node *node = NULL;
+
+    if(value->type == STREAM_VAL || value->type == THUNK_VAL
+       || value->type == ARRAY_VAL || value->type == MAP_VAL)
+        return 1;
+
+    if(value->type == SEQ_VAL)
+        for(node = value->data.seq_val->front; node; node = node->next)
+            if(filter_shared(node->data))
+                return 1;
+
+    return 0;
+}
+
+/*** sortby
+ * Sorting functional form.  Accepts a single key function argument.  Input
+ * should be a list, and the return value is the same list ordered by the
+ * result of applying the key function to each element, as lt orders them.
+ * Elements with equal keys keep their original order.  Returns Bottom if
+ * the keys aren't all numbers, all characters or all strings.
+ *
+ * sortby{ k } : < x, y, z > = < y, z, x > if k : y < k : z < k : x
+ *
+ * The key is found just once for each element.  Int and character keys
+ * are radix sorted, anything else is merge sorted.
+ */
+struct value *sortby(struct list *args, struct value *in)
+{
+    struct function *key = list_get(args, 0);
+    struct sort_item *items = NULL;
+    struct value **elements = NULL;
+    struct list_node *node = NULL;
+    enum sort_kind kind = SORT_EMPTY;
+    int *keys = NULL;
+    int *order = NULL;
+    int count;
+    int i;
+
+    if(args->count != 1 || (in->type != SEQ_VAL && in->type != STREAM_VAL))
+    {
+        value_delete(in);
+        return value_new();
+    }
+
+    if(in->type == STREAM_VAL)
+        in = stream_materialize(in);
+
+    count = in->data.seq_val->count;
+    items = (struct sort_item*)malloc((count + 1) * sizeof(struct sort_item));
+    elements = (struct value**)malloc((count + 1) * sizeof(struct value*));
+    for(node = in->data.seq_val->front, i = 0; node; node = node->next, i++)
+    {
+        elements[i] = node->data;
+        items[i].value = function_exec(key, value_copy(node->data));
+        items[i].index = i;
+        kind = sort_classify(kind, items[i].value);
+    }
 
+    order = (int*)malloc((count + 1) * sizeof(int));
+    if(kind == SORT_INTS || kind == SORT_CHARS)
+    {
+        keys = (int*)malloc((count + 1) * sizeof(int));
+        for(i = 0; i < count; i++)
+        {
+            keys[i] = kind == SORT_INTS ? items[i].value->data.int_val
+                : items[i].value->data.char_val;
+            order[i] = i;
+        }
+
+        sort_ints(keys, order, count);
+        free(keys);
+    }
+    else if(kind != SORT_UNORDERED)
+    {
+        sort_merge(items, count, sort_order);
+        for(i = 0; i < count; i++)
+            order[i] = items[i].index;
+    }
+
+    for(i = 0; i < count; i++)
+        value_delete(items[i].value);
+    free(items);
+
+    if(kind == SORT_UNORDERED)
+    {
+        free(elements);
+        free(order);
+        value_delete(in);
+        return value_new();
+    }
+
+    // The input becomes the output, with its elements moved into order
+    for(node = in->data.seq_val->front, i = 0; node; node = node->next, i++)
+        node->data = elements[order[i]];
+
+    free(elements);
+    free(order);
+    return in;
 }
 
 /*** reduce
@@ -168,44 +692,356 @@ struct value *map(struct list *args, struct value *in)
  * right-most element, and so on until the list is exhausted.
  *
  * reduce{ f } : < x, y, z > = f : < f : < x, y>, z >
+ *
+ * Streams are reduced as they're pulled, without ever being held whole.
  */
 struct value *reduce(struct list *args, struct value *in)
 {
-    struct value *out = value_new();
+    if(args->count != 1 || (in->type != SEQ_VAL && in->type != STREAM_VAL))
+    {
+        value_delete(in);
+        return value_new();
+    }
+
+    return reduce_mapped(list_get(args, 0), NULL, in);
+}
+
+/*** mapreduce
+ * Fused map and reduce.  Accepts exactly two function arguments, a reducing
+ * function and a mapping function.  Equivalent to reducing with the first
+ * argument the result of mapping the second over the input list, but each
+ * element is mapped just as it's needed, so the mapped list is never built.
+ *
+ * mapreduce{ r, f } : < x, y, z > = r : < r : < f : x, f : y >, f : z >
+ *
+ * The optimizer fuses reduce{ r } composed directly with map{ f } into
+ * this form whenever neither r nor f can perform I/O.  Streams are mapped
+ * and reduced as they're pulled, without ever being held whole.
+ */
+struct value *mapreduce(struct list *args, struct value *in)
+{
+    if(args->count != 2 || (in->type != SEQ_VAL && in->type != STREAM_VAL))
+    {
+        value_delete(in);
+        return value_new();
+    }
+
+    return reduce_mapped(list_get(args, 0), list_get(args, 1), in);
+}
+
+// Reduces a sequence or stream with f, applying map to each element first
+// unless it's NULL
+struct value *reduce_mapped(struct function *f, struct function *map,
+                            struct value *in)
+{
+    struct value *out = NULL;
     struct value *v = NULL;
+
+    // The first two elements make the initial pair, after which it's the
+    // same as a left fold
+    out = fold_next(map, in);
+    v = out ? fold_next(map, in) : NULL;
+    if(!v || value_is_bottom(out) || value_is_bottom(v))
+    {
+        if(v)
+            value_delete(v);
+        if(out)
+            value_delete(out);
+        value_delete(in);
+        return value_new();
+    }
+
+    return fold_left(f, map, fold_apply(f, NULL, out, v), in);
+}
+
+/*** foldl
+ * Left fold.  Accepts a single function argument.  Expects input in the
+ * form of a pair of an initial value and a list.  Feeds the argument
+ * function a pair of the initial value and the first element of the list,
+ * then a pair of that result and the next element, and so on, returning
+ * the last result.  Unlike reduce, a list of one element or none is fine,
+ * an empty list just gives back the initial value.
+ *
+ * foldl{ f } : < a, < x, y, z > > = f : < f : < f : < a, x >, y >, z >
+ *
+ * Streams are folded as they're pulled, without ever being held whole.
+ */
+struct value *foldl(struct list *args, struct value *in)
+{
+    struct value *init = NULL;
+
+    if(!fold_input(args, in))
+    {
+        value_delete(in);
+        return value_new();
+    }
+
+    init = list_pop(in->data.seq_val);
+    return fold_left(list_get(args, 0), NULL, init, fold_list(in));
+}
+
+/*** foldr
+ * Right fold.  Accepts a single function argument.  Expects input in the
+ * form of a pair of an initial value and a list.  Feeds the argument
+ * function a pair of the last element of the list and the initial value,
+ * then a pair of the element before it and that result, and so on back to
+ * the front of the list, returning the last result.  An empty list just
+ * gives back the initial value.
+ *
+ * foldr{ f } : < a, < x, y, z > > = f : < x, f : < y, f : < z, a > > >
+ */
+struct value *foldr(struct list *args, struct value *in)
+{
     struct function *f = list_get(args, 0);
-    int i = 0;
+    struct value *out = NULL;
+    struct value *list = NULL;
+    struct value *pair = NULL;
 
-    // Check for valid input
-    if (args->count != 1 || in->type != SEQ_VAL || in->data.seq_val->count < 2)
+    if(!fold_input(args, in))
     {
         value_delete(in);
-        return out;
+        return value_new();
     }
 
-    // Setting up initial pair
+    out = list_pop(in->data.seq_val);
+    list = stream_materialize(fold_list(in));
+    pair = f->type == PRIMITIVE ? pair_new(NULL, NULL) : NULL;
+
+    while(list->data.seq_val->count && out->type != BOTTOM_VAL)
+        out = fold_apply(f, pair, list_pop_back(list->data.seq_val), out);
+
+    if(pair)
+        pair_free(pair);
+    value_delete(list);
+    return out;
+}
+
+// Checks for the single function argument and < init, list > input of a
+// fold, forcing the list if it was deferred
+int fold_input(struct list *args, struct value *in)
+{
+    struct value *list = NULL;
+
+    if(args->count != 1 || in->type != SEQ_VAL || in->data.seq_val->count != 2)
+        return 0;
+
+    list = in->data.seq_val->back->data;
+    value_force(list, 0);
+    return list->type == SEQ_VAL || list->type == STREAM_VAL;
+}
+
+// Takes the list out of the input of a fold, once its initial value has
+// been taken, and deletes what's left
+struct value *fold_list(struct value *in)
+{
+    struct value *list = list_pop(in->data.seq_val);
+
+    value_delete(in);
+    return list;
+}
+
+// Folds the elements of a sequence or stream onto out from the left,
+// taking ownership of both, applying map to each element first unless it's
+// NULL.  A bottom result or element ends the fold early with bottom, since
+// every step after it would be bottom too.
+struct value *fold_left(struct function *f, struct function *map,
+                        struct value *out, struct value *in)
+{
+    struct value *pair = f->type == PRIMITIVE ? pair_new(NULL, NULL) : NULL;
+    struct value *v = NULL;
+
+    while(out->type != BOTTOM_VAL && (v = fold_next(map, in)))
+    {
+        if(value_is_bottom(v))
+        {
+            value_delete(v);
+            value_delete(out);
+            out = value_new();
+            break;
+        }
+        out = fold_apply(f, pair, out, v);
+    }
+
+    if(pair)
+        pair_free(pair);
+    value_delete(in);
+    return out;
+}
+
+// Takes the next element of a sequence or stream, applying map to it
+// unless it's NULL, returns NULL once there are none left.  Elements are
+// moved out of a sequence, not copied.
+struct value *fold_next(struct function *map, struct value *in)
+{
+    struct value *v = NULL;
+
+    if(in->type == STREAM_VAL)
+        v = stream_next(in->data.stream_val);
+    else if(in->data.seq_val->count)
+        v = list_pop(in->data.seq_val);
+
+    if(v && map)
+        v = stream_materialize(function_exec(map, v));
+    return v;
+}
+
+// Applies f to a pair of two values, taking ownership of them.  Primitives
+// don't consume their input, so when f is one the pair given is filled in
+// and reused instead of allocating a new one.
+struct value *fold_apply(struct function *f, struct value *pair,
+                         struct value *a, struct value *b)
+{
+    struct value *out = NULL;
+
+    if(!pair)
+        return function_exec(f, pair_new(a, b));
+
+    if(value_is_bottom(a) || value_is_bottom(b))
+    {
+        out = value_new();
+    }
+    else
+    {
+        pair->data.seq_val->front->data = a;
+        pair->data.seq_val->back->data = b;
+        out = primitive_exec(f, pair);
+    }
+
+    value_delete(a);
+    value_delete(b);
+    return out;
+}
+
+// Creates a pair from two values, taking ownership of them
+struct value *pair_new(struct value *a, struct value *b)
+{
+    struct value *pair = value_new();
+
+    pair->type = SEQ_VAL;
+    pair->data.seq_val = list_new();
+    list_push_back(pair->data.seq_val, a);
+    list_push_back(pair->data.seq_val, b);
+    return pair;
+}
+
+// Frees a pair without its elements
+void pair_free(struct value *pair)
+{
+    list_delete(pair->data.seq_val);
+    free(pair);
+}
+
+/*** while
+ * Iteration form.  Accepts exactly two arguments.  Feeds its input to the
+ * first argument, and as long as the result is boolean True, replaces the
+ * input with the result of feeding it to the second argument.  Returns the
+ * input once the first argument returns False, or Bottom if it returns
+ * anything other than a boolean.  Runs as a single loop, so any number of
+ * iterations take constant space.
+ *
+ * while{ p, f } : x = if p : x then while{ p, f } : (f : x) else x
+ */
+struct value *while_loop(struct list *args, struct value *in)
+{
+    struct function *p = NULL;
+    struct function *f = NULL;
+    struct value *test = NULL;
+
+    if(args->count != 2)
+    {
+        value_delete(in);
+        return value_new();
+    }
+
+    p = list_get(args, 0);
+    f = list_get(args, 1);
+
+    for(;;)
+    {
+        test = function_exec(p, value_copy(in));
+        if(test->type != BOOL_VAL)
+        {
+            value_delete(test);
+            value_delete(in);
+            return value_new();
+        }
+
+        if(!test->data.bool_val)
+        {
+            value_delete(test);
+            return in;
+        }
+
+        value_delete(test);
+        in = function_exec(f, in);
+    }
+}
+
+/*** unfold
+ * Sequence generation.  Accepts exactly three arguments: a stopping test, an
+ * emitting function, and a stepping function.  Starting with its input as a
+ * seed, feeds the seed to the first argument.  If the result is boolean
+ * False, the result of feeding the seed to the second argument is added to
+ * the output and the seed is replaced by the result of feeding it to the
+ * third argument, and so on until the first argument returns True.  Returns
+ * Bottom if the test ever returns anything other than a boolean.  Runs as a
+ * single loop, appending to one sequence.  With lazy evaluation on, an
+ * unfold whose arguments can't perform I/O produces a stream instead, which
+ * emits each element only as it's needed.
+ *
+ * unfold{ p, f, g } : x = if p : x then <> else
+ *                         < f : x > ++ unfold{ p, f, g } : (g : x)
+ */
+struct value *unfold(struct list *args, struct value *in)
+{
+    struct function *stop = NULL;
+    struct function *emit = NULL;
+    struct function *step = NULL;
+    struct value *out = NULL;
+    struct value *test = NULL;
+    struct value *element = NULL;
+
+    if(args->count != 3)
+    {
+        value_delete(in);
+        return value_new();
+    }
+
+    stop = list_get(args, 0);
+    emit = list_get(args, 1);
+    step = list_get(args, 2);
+
+    out = value_new();
     out->type = SEQ_VAL;
     out->data.seq_val = list_new();
-    list_push_back(out->data.seq_val,
-                   value_copy(list_get(in->data.seq_val, 0)));
-    list_push_back(out->data.seq_val,
-                   value_copy(list_get(in->data.seq_val, 1)));
-    // Pairing up elements and feeding them to f
-    for (i = 2; i <= in->data.seq_val->count; i++)
-    {
-        out = function_exec(f, out);
-        if (i < in->data.seq_val->count)
+
+    for(;;)
+    {
+        test = function_exec(stop, value_copy(in));
+        if(test->type != BOOL_VAL || test->data.bool_val)
+            break;
+        value_delete(test);
+
+        // A bottom element makes the whole sequence bottom, so there's no
+        // need to go on
+        element = function_exec(emit, value_copy(in));
+        if(value_is_bottom(element))
         {
-            v = value_new();
-            v->type = SEQ_VAL;
-            v->data.seq_val = list_new();
-            list_push_back(v->data.seq_val, out);
-            list_push_back(v->data.seq_val,
-                           value_copy(list_get(in->data.seq_val, i)));
-            out = v;
+            test = element;
+            break;
         }
+        list_push_back(out->data.seq_val, element);
+
+        in = function_exec(step, in);
+    }
+
+    if(test->type != BOOL_VAL)
+    {
+        value_delete(out);
+        out = value_new();
     }
 
+    value_delete(test);
     value_delete(in);
     return out;
 }
@@ -21,8 +21,11 @@
 #ifndef FORMS_H
 #define FORMS_H
 
+#define PFILTER_CHUNK_MIN 1024 // Fewest elements pfilter gives one thread
+
 struct value;
 struct list;
+struct function;
 
 /**
  * The functional forms and comments in this header file will be
@@ -43,12 +46,20 @@ struct list;
  */
 struct value *compose(struct list *args, struct value *in);
 
+// Runs every function of a composition but the outermost, replacing *in
+// with the result, and returns the outermost function for the caller to
+// run in tail position, or NULL if there are no functions
+struct function *compose_tail(struct list *args, struct value **in);
+
 /*** construct
  * Sequence construction.  Feeds its input to each of its argument functions,
  * and generate a sequence where each element is the output of one of the
  * argument functions.
  *
  * construct{ f, g } : x  = < f : x, g : x >
+ *
+ * With lazy evaluation on, elements that don't perform I/O are evaluated
+ * only when a primitive needs them.
  */
 struct value *construct(struct list *args, struct value *in);
 
@@ -62,15 +73,71 @@ struct value *construct(struct list *args, struct value *in);
  */
 struct value *iff(struct list *args, struct value *in);
 
+// Runs the test of a conditional and returns the branch it selects, for
+// the caller to run in tail position on *in.  Returns NULL, with *in
+// deleted, if the test doesn't produce a boolean.
+struct function *iff_tail(struct list *args, struct value **in);
+
+// Checks whether a conditional is the whole definition of a function, one
+// of whose branches prepends or appends an element onto the result of
+// calling that function again, as in
+//
+//   f = if{ p, g, compose{ prepend, construct{ h, compose{ f, k } } } }
+//
+// Returns the number of that branch, 1 or 2, or 0 if there isn't one
+int iff_cons_branch(struct function *function);
+
 /*** map
  * Mapping functional form.  Accepts a single function argument.  Input to the
  * form should always be in the form of a list, and the return value will be
  * the result of applying the argument function to each element in the list.
  *
  * map{ f } : < x, y, z > = < f : x, f : y, f : z >
+ *
+ * Mapping over a stream produces another stream, which applies f to each
+ * element only as it's pulled.
  */
 struct value *map(struct list *args, struct value *in);
 
+/*** filter
+ * Filtering functional form.  Accepts a single predicate argument.  Input
+ * should be a list, and the return value is the list of those elements for
+ * which the predicate returns True, in their original order.  Returns Bottom
+ * if the predicate returns anything other than a boolean.
+ *
+ * filter{ p } : < x, y, z > = < x, z > if p : x and p : z are True, and
+ * p : y is False
+ *
+ * Filtering a stream produces another stream, which tests each element
+ * only as it's pulled.
+ */
+struct value *filter(struct list *args, struct value *in);
+
+/*** pfilter
+ * Parallel filtering functional form.  The same as filter, except that the
+ * input list is split into chunks, one for each processor, and the
+ * predicate is applied to each chunk on its own thread.  Falls back to
+ * filter for short lists, predicates that perform I/O, and lists holding
+ * streams, arrays, maps or deferred elements.
+ *
+ * pfilter{ p } : < x, y, z > = filter{ p } : < x, y, z >
+ */
+struct value *pfilter(struct list *args, struct value *in);
+
+/*** sortby
+ * Sorting functional form.  Accepts a single key function argument.  Input
+ * should be a list, and the return value is the same list ordered by the
+ * result of applying the key function to each element, as lt orders them.
+ * Elements with equal keys keep their original order.  Returns Bottom if
+ * the keys aren't all numbers, all characters or all strings.
+ *
+ * sortby{ k } : < x, y, z > = < y, z, x > if k : y < k : z < k : x
+ *
+ * The key is found just once for each element.  Int and character keys
+ * are radix sorted, anything else is merge sorted.
+ */
+struct value *sortby(struct list *args, struct value *in);
+
 /*** reduce
  * Reducing functional form.  Accepts a single function argument.  Expects
  * input in the form of a list, return value is the result of first applying
@@ -79,7 +146,78 @@ struct value *map(struct list *args, struct value *in);
  * right-most element, and so on until the list is exhausted.
  *
  * reduce{ f } : < x, y, z > = f : < f : < x, y>, z >
+ *
+ * Streams are reduced as they're pulled, without ever being held whole.
  */
 struct value *reduce(struct list *args, struct value *in);
 
+/*** mapreduce
+ * Fused map and reduce.  Accepts exactly two function arguments, a reducing
+ * function and a mapping function.  Equivalent to reducing with the first
+ * argument the result of mapping the second over the input list, but each
+ * element is mapped just as it's needed, so the mapped list is never built.
+ *
+ * mapreduce{ r, f } : < x, y, z > = r : < r : < f : x, f : y >, f : z >
+ *
+ * The optimizer fuses reduce{ r } composed directly with map{ f } into
+ * this form whenever neither r nor f can perform I/O.  Streams are mapped
+ * and reduced as they're pulled, without ever being held whole.
+ */
+struct value *mapreduce(struct list *args, struct value *in);
+
+/*** foldl
+ * Left fold.  Accepts a single function argument.  Expects input in the
+ * form of a pair of an initial value and a list.  Feeds the argument
+ * function a pair of the initial value and the first element of the list,
+ * then a pair of that result and the next element, and so on, returning
+ * the last result.  Unlike reduce, a list of one element or none is fine,
+ * an empty list just gives back the initial value.
+ *
+ * foldl{ f } : < a, < x, y, z > > = f : < f : < f : < a, x >, y >, z >
+ *
+ * Streams are folded as they're pulled, without ever being held whole.
+ */
+struct value *foldl(struct list *args, struct value *in);
+
+/*** foldr
+ * Right fold.  Accepts a single function argument.  Expects input in the
+ * form of a pair of an initial value and a list.  Feeds the argument
+ * function a pair of the last element of the list and the initial value,
+ * then a pair of the element before it and that result, and so on back to
+ * the front of the list, returning the last result.  An empty list just
+ * gives back the initial value.
+ *
+ * foldr{ f } : < a, < x, y, z > > = f : < x, f : < y, f : < z, a > > >
+ */
+struct value *foldr(struct list *args, struct value *in);
+
+/*** while
+ * Iteration form.  Accepts exactly two arguments.  Feeds its input to the
+ * first argument, and as long as the result is boolean True, replaces the
+ * input with the result of feeding it to the second argument.  Returns the
+ * input once the first argument returns False, or Bottom if it returns
+ * anything other than a boolean.  Runs as a single loop, so any number of
+ * iterations take constant space.
+ *
+ * while{ p, f } : x = if p : x then while{ p, f } : (f : x) else x
+ */
+struct value *while_loop(struct list *args, struct value *in);
+
+/*** unfold
+ * Sequence generation.  Accepts exactly three arguments: a stopping test, an
+ * emitting function, and a stepping function.  Starting with its input as a
+ * seed, feeds the seed to the first argument.  If the result is boolean
+ * False, the result of feeding the seed to the second argument is added to
+ * the output and the seed is replaced by the result of feeding it to the
+ * third argument, and so on until the first argument returns True.  Returns
+ * Bottom if the test ever returns anything other than a boolean.  Runs as a
+ * single loop, appending to one sequence.  With lazy evaluation on, an
+ * unfold whose arguments can't perform I/O produces a stream instead, which
+ * emits each element only as it's needed.
+ *
+ * unfold{ p, f, g } : x = if p : x then <> else
+ *                         < f : x > ++ unfold{ p, f, g } : (g : x)
+ */
+struct value *unfold(struct list *args, struct value *in);
+
 #endif // FORMS_H
@@ -0,0 +1,71 @@
+0,
+3,
+1,
+-69,
+-64,
+0,
+1,
+-63,
+-60,
+0,
+0,
+-57,
+-56,
+0,
+1,
+2,
+-54,
+0,
+2,
+-52,
+0,
+-48,
+0,
+0,
+-47,
+-46,
+-43,
+-41,
+0,
+0,
+-38,
+0,
+1,
+-35,
+0,
+-34,
+0,
+1,
+-31,
+0,
+-29,
+0,
+1,
+-28,
+-27,
+-26,
+-25,
+-24,
+0,
+0,
+-22,
+-21,
+6,
+-20,
+4,
+-17,
+2,
+4,
+4,
+-16,
+6,
+0,
+0,
+0,
+0,
+1,
+-14,
+0,
+-3,
+-1,
+0
@@ -0,0 +1,71 @@
+{"sortby", 6, FORM, 10, 0x9e007810u},
+{"readln", 6, PRIMITIVE, 42, 0x250b37ffu},
+{"vmax", 4, PRIMITIVE, 55, 0x8f73895du},
+{"mod", 3, PRIMITIVE, 36, 0xdf9e7283u},
+{"mapnew", 6, PRIMITIVE, 33, 0x90b0daddu},
+{"mapreduce", 9, FORM, 7, 0x0a387b23u},
+{"eq", 2, PRIMITIVE, 18, 0x441a6a43u},
+{"/", 1, PRIMITIVE, 3, 0x2a0c975eu},
+{"mapkeys", 7, PRIMITIVE, 32, 0x6a4a9a91u},
+{"head", 4, PRIMITIVE, 23, 0x32694bc3u},
+{"mapput", 6, PRIMITIVE, 34, 0xbd5666d2u},
+{"v-", 2, PRIMITIVE, 52, 0x804a26ecu},
+{"println", 7, PRIMITIVE, 39, 0x18bff8a6u},
+{"readlines", 9, PRIMITIVE, 41, 0x1e1bb83cu},
+{"distl", 5, PRIMITIVE, 14, 0x0097471fu},
+{"gt", 2, PRIMITIVE, 21, 0x4b208576u},
+{"topk", 4, PRIMITIVE, 47, 0x568adcf5u},
+{"1-", 2, PRIMITIVE, 5, 0x20eb3223u},
+{"vabs", 4, PRIMITIVE, 54, 0x46d2f727u},
+{"range", 5, PRIMITIVE, 40, 0xfadc0cd2u},
+{"flush", 5, PRIMITIVE, 20, 0xb2f3fe9du},
+{"trans", 5, PRIMITIVE, 48, 0x6b440ed1u},
+{"int", 3, PRIMITIVE, 25, 0x95e97e5eu},
+{"distr", 5, PRIMITIVE, 15, 0x169769c1u},
+{"id", 2, PRIMITIVE, 24, 0x37386ae0u},
+{"if", 2, FORM, 5, 0x39386e06u},
+{"foldl", 5, FORM, 3, 0x9902c292u},
+{"-", 1, PRIMITIVE, 2, 0x280c9438u},
+{"+", 1, PRIMITIVE, 1, 0x2e0c9daau},
+{"1+", 2, PRIMITIVE, 4, 0x26eb3b95u},
+{"v*", 2, PRIMITIVE, 50, 0x7f4a2559u},
+{"unfold", 6, FORM, 11, 0x49f38209u},
+{"lte", 3, PRIMITIVE, 29, 0x3d943418u},
+{"foldr", 5, FORM, 4, 0xab02dee8u},
+{"eprint", 6, PRIMITIVE, 16, 0x6e4f9a47u},
+{"vsqrt", 5, PRIMITIVE, 57, 0x90ae237bu},
+{"array", 5, PRIMITIVE, 11, 0x8a58ad26u},
+{"asum", 4, PRIMITIVE, 12, 0xfde019dfu},
+{"shape", 5, PRIMITIVE, 43, 0x9dc3d926u},
+{"construct", 9, FORM, 1, 0x40c09172u},
+{"a-", 2, PRIMITIVE, 8, 0x00248c93u},
+{"tail", 4, PRIMITIVE, 46, 0x0f39a863u},
+{"a/", 2, PRIMITIVE, 9, 0x02248fb9u},
+{"float", 5, PRIMITIVE, 19, 0xa6c45d85u},
+{"mapfromseq", 10, PRIMITIVE, 30, 0x4a1a70c0u},
+{"matmul", 6, PRIMITIVE, 35, 0x94063009u},
+{"a+", 2, PRIMITIVE, 7, 0x06249605u},
+{"lines", 5, PRIMITIVE, 27, 0xe1e4263cu},
+{"str", 3, PRIMITIVE, 45, 0xc24bd190u},
+{"pfilter", 7, FORM, 8, 0xb1906c09u},
+{"gte", 3, PRIMITIVE, 22, 0x57317ce9u},
+{"append", 6, PRIMITIVE, 10, 0x069982e1u},
+{"reduce", 6, FORM, 9, 0x77548ee7u},
+{"const", 5, PRIMITIVE, 13, 0x664fd1d4u},
+{"vmin", 4, PRIMITIVE, 56, 0x99601163u},
+{"unarray", 7, PRIMITIVE, 49, 0x95fea69bu},
+{"sort", 4, PRIMITIVE, 44, 0x042bc8d1u},
+{"filter", 6, FORM, 2, 0xc7e16877u},
+{"length", 6, PRIMITIVE, 26, 0x83d03615u},
+{"while", 5, FORM, 12, 0x0dc628ceu},
+{"compose", 7, FORM, 0, 0x00a878f3u},
+{"prepend", 7, PRIMITIVE, 37, 0xf233cecfu},
+{"lt", 2, PRIMITIVE, 28, 0x5d31eaedu},
+{"*", 1, PRIMITIVE, 0, 0x2f0c9f3du},
+{"print", 5, PRIMITIVE, 38, 0x16378a88u},
+{"v/", 2, PRIMITIVE, 53, 0x824a2a12u},
+{"mapget", 6, PRIMITIVE, 31, 0xa9d20c63u},
+{"eprintln", 8, PRIMITIVE, 17, 0xf275020du},
+{"v+", 2, PRIMITIVE, 51, 0x7e4a23c6u},
+{"map", 3, FORM, 6, 0xdfa2efb1u},
+{"a*", 2, PRIMITIVE, 6, 0x05249472u}
@@ -1,5 +1,13 @@
 compose,
 construct,
+filter,
+foldl,
+foldr,
 iff,
 map,
-reduce
+mapreduce,
+pfilter,
+reduce,
+sortby,
+unfold,
+while_loop
@@ -1,6 +1,14 @@
 "compose",
 "construct",
+"filter",
+"foldl",
+"foldr",
 "if",
 "map",
+"mapreduce",
+"pfilter",
 "reduce",
+"sortby",
+"unfold",
+"while",
 ""
@@ -4,22 +4,55 @@ subtract,
 divide,
 one_plus,
 one_minus,
+array_times,
+array_plus,
+array_minus,
+array_over,
 append,
+pack_array,
+axis_sum,
 constant,
+distl,
+distr,
+eprint_str,
+eprintln_str,
 eq,
 to_float,
+flush,
 gt,
 gte,
 head,
 id,
 to_int,
 length,
+lines,
 lt,
 lte,
+map_from_seq,
+map_get,
+map_keys,
+new_map,
+map_put,
+matmul,
 mod,
 prepend,
 print_str,
 println_str,
+range,
+readlines_str,
 readln_str,
+shape,
+sort,
 to_string,
-tail
+tail,
+topk,
+trans,
+unpack_array,
+vector_times,
+vector_plus,
+vector_minus,
+vector_over,
+vector_abs,
+vector_max,
+vector_min,
+vector_sqrt
@@ -4,23 +4,56 @@
 "/",
 "1+",
 "1-",
+"a*",
+"a+",
+"a-",
+"a/",
 "append",
+"array",
+"asum",
 "const",
+"distl",
+"distr",
+"eprint",
+"eprintln",
 "eq",
 "float",
+"flush",
 "gt",
 "gte",
 "head",
 "id",
 "int",
 "length",
+"lines",
 "lt",
 "lte",
+"mapfromseq",
+"mapget",
+"mapkeys",
+"mapnew",
+"mapput",
+"matmul",
 "mod",
 "prepend",
 "print",
 "println",
+"range",
+"readlines",
 "readln",
+"shape",
+"sort",
 "str",
 "tail",
+"topk",
+"trans",
+"unarray",
+"v*",
+"v+",
+"v-",
+"v/",
+"vabs",
+"vmax",
+"vmin",
+"vsqrt",
 ""
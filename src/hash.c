@@ -0,0 +1,77 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include "hash.h"
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define FNV32_OFFSET_BASIS 2166136261U
+#define FNV32_PRIME 16777619U
+
+// Hashes a block of memory with 64-bit FNV-1a
+uint64_t hash_bytes(const void *data, size_t length)
+{
+    const unsigned char *c = (const unsigned char*)data;
+    uint64_t h = FNV_OFFSET_BASIS;
+    size_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        h ^= c[i];
+        h *= FNV_PRIME;
+    }
+
+    return h;
+}
+
+// Hashes a block of memory with 32-bit FNV-1a
+uint32_t hash_bytes32(const void *data, size_t length)
+{
+    const unsigned char *c = (const unsigned char*)data;
+    uint32_t h = FNV32_OFFSET_BASIS;
+    size_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        h ^= c[i];
+        h *= FNV32_PRIME;
+    }
+
+    return h;
+}
+
+// Scrambles the bits of a number, with the finalizer of SplitMix64
+uint64_t hash_mix(uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// Adds a hash onto a running hash, in a way that depends on their order
+uint64_t hash_combine(uint64_t seed, uint64_t h)
+{
+    return hash_mix(seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6)
+                            + (seed >> 2)));
+}
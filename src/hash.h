@@ -0,0 +1,37 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hashes a block of memory with 64-bit FNV-1a
+uint64_t hash_bytes(const void *data, size_t length);
+// Hashes a block of memory with 32-bit FNV-1a
+uint32_t hash_bytes32(const void *data, size_t length);
+// Scrambles the bits of a number, so that nearby numbers hash far apart
+uint64_t hash_mix(uint64_t h);
+// Adds a hash onto a running hash, in a way that depends on their order
+uint64_t hash_combine(uint64_t seed, uint64_t h);
+
+#endif // HASH_H
@@ -0,0 +1,233 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashmap.h"
+#include "interpreter.h"
+#include "list.h"
+
+// Returns the slot holding key, or the empty slot where it would go
+int *hashmap_slot(struct hashmap *map, struct value *key, uint64_t hash);
+// Doubles the number of slots in a map
+void hashmap_grow(struct hashmap *map);
+
+// Creates an empty map
+struct hashmap *hashmap_new()
+{
+    struct hashmap *map = (struct hashmap*)malloc(sizeof(struct hashmap));
+
+    map->refs = 1;
+    map->count = 0;
+    map->capacity = HASHMAP_START_SIZE;
+    map->entries = (struct hashmap_entry*)
+        malloc(HASHMAP_START_SIZE * sizeof(struct hashmap_entry));
+    map->size = HASHMAP_START_SIZE;
+    map->slots = (int*)calloc(HASHMAP_START_SIZE, sizeof(int));
+    return map;
+}
+
+// Releases a reference to a map, freeing it once it has no others
+void hashmap_release(struct hashmap *map)
+{
+    int i;
+
+    if(--map->refs)
+        return;
+
+    for(i = 0; i < map->count; i++)
+    {
+        value_delete(map->entries[i].key);
+        value_delete(map->entries[i].value);
+    }
+
+    free(map->entries);
+    free(map->slots);
+    free(map);
+}
+
+// Copies a map along with its keys and values
+struct hashmap *hashmap_copy(struct hashmap *map)
+{
+    struct hashmap *copy = (struct hashmap*)malloc(sizeof(struct hashmap));
+    int i;
+
+    copy->refs = 1;
+    copy->count = map->count;
+    copy->capacity = map->capacity;
+    copy->entries = (struct hashmap_entry*)
+        malloc(map->capacity * sizeof(struct hashmap_entry));
+    copy->size = map->size;
+    copy->slots = (int*)malloc(map->size * sizeof(int));
+    memcpy(copy->slots, map->slots, map->size * sizeof(int));
+
+    for(i = 0; i < map->count; i++)
+    {
+        copy->entries[i].hash = map->entries[i].hash;
+        copy->entries[i].key = value_copy(map->entries[i].key);
+        copy->entries[i].value = value_copy(map->entries[i].value);
+    }
+
+    return copy;
+}
+
+// Wraps a map in a new value, which takes over the caller's reference
+struct value *hashmap_value(struct hashmap *map)
+{
+    struct value *value = value_new();
+
+    value->type = MAP_VAL;
+    value->data.map_val = map;
+    return value;
+}
+
+// Finds the value for a key, which the map continues to own, or NULL if
+// there isn't one
+struct value *hashmap_get(struct hashmap *map, struct value *key)
+{
+    int *slot = hashmap_slot(map, key, value_hash(key));
+
+    return *slot ? map->entries[*slot - 1].value : NULL;
+}
+
+// Sets the value for a key, taking ownership of both
+void hashmap_put(struct hashmap *map, struct value *key,
+                 struct value *value)
+{
+    uint64_t hash = value_hash(key);
+    int *slot = hashmap_slot(map, key, hash);
+    struct hashmap_entry *entry = NULL;
+
+    if(*slot)
+    {
+        entry = map->entries + *slot - 1;
+        value_delete(entry->value);
+        value_delete(key);
+        entry->value = value;
+        return;
+    }
+
+    if((map->count + 1) * 100 > map->size * HASHMAP_MAX_LOAD)
+    {
+        hashmap_grow(map);
+        slot = hashmap_slot(map, key, hash);
+    }
+
+    if(map->count == map->capacity)
+    {
+        map->capacity *= 2;
+        map->entries = (struct hashmap_entry*)
+            realloc(map->entries,
+                    map->capacity * sizeof(struct hashmap_entry));
+    }
+
+    entry = map->entries + map->count++;
+    entry->hash = hash;
+    entry->key = key;
+    entry->value = value;
+    *slot = map->count;
+}
+
+// Checks whether two maps have the same keys with equal values, in any
+// order
+int hashmap_equal(struct hashmap *a, struct hashmap *b)
+{
+    struct value *value = NULL;
+    int i;
+
+    if(a == b)
+        return 1;
+    if(a->count != b->count)
+        return 0;
+
+    for(i = 0; i < a->count; i++)
+    {
+        value = hashmap_get(b, a->entries[i].key);
+        if(!value || !value_equal(a->entries[i].value, value))
+            return 0;
+    }
+
+    return 1;
+}
+
+// Makes a sequence of pairs of each key and its value, in order
+struct value *hashmap_pairs(struct hashmap *map)
+{
+    struct value *out = value_new();
+    struct value *pair = NULL;
+    int i;
+
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    for(i = 0; i < map->count; i++)
+    {
+        pair = value_new();
+        pair->type = SEQ_VAL;
+        pair->data.seq_val = list_new();
+        list_push_back(pair->data.seq_val, value_copy(map->entries[i].key));
+        list_push_back(pair->data.seq_val,
+                       value_copy(map->entries[i].value));
+        list_push_back(out->data.seq_val, pair);
+    }
+
+    return out;
+}
+
+// Returns the slot holding key, or the empty slot where it would go
+int *hashmap_slot(struct hashmap *map, struct value *key, uint64_t hash)
+{
+    int mask = map->size - 1;
+    int i = hash & mask;
+    struct hashmap_entry *entry = NULL;
+
+    // The load limit guarantees an empty slot to stop at
+    for(;; i = (i + 1) & mask)
+    {
+        if(!map->slots[i])
+            return map->slots + i;
+
+        entry = map->entries + map->slots[i] - 1;
+        if(entry->hash == hash && value_equal(entry->key, key))
+            return map->slots + i;
+    }
+}
+
+// Doubles the number of slots in a map
+void hashmap_grow(struct hashmap *map)
+{
+    int mask = map->size * 2 - 1;
+    int i, j;
+
+    map->size *= 2;
+    free(map->slots);
+    map->slots = (int*)calloc(map->size, sizeof(int));
+
+    // The entries stay where they are, only the slots pointing to them
+    // move
+    for(i = 0; i < map->count; i++)
+    {
+        for(j = map->entries[i].hash & mask; map->slots[j];
+            j = (j + 1) & mask)
+            ;
+        map->slots[j] = i + 1;
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stdint.h>
+
+#define HASHMAP_START_SIZE 8 // Initial number of slots, a power of two
+#define HASHMAP_MAX_LOAD 75  // Percentage of slots used before growing
+
+/**
+ * Hash maps from values to values.  Keys are found by their structural
+ * hash and compared the way eq compares them.  Entries are listed in the
+ * order their keys were first added, so the same puts always give the
+ * same map, however the keys happen to hash.
+ *
+ * Copies of a map value share a single map, which is only changed in
+ * place while no other value holds it.
+ */
+
+struct value;
+
+struct hashmap_entry
+{
+    uint64_t hash;
+    struct value *key;
+    struct value *value;
+};
+
+// The entries are kept in order in an array, indexed by an open-addressed
+// table of slots with linear probing.  Each slot holds one more than the
+// index of its entry, or zero if it's empty.
+struct hashmap
+{
+    // Number of values sharing the map
+    int refs;
+    int count;
+    int capacity;
+    struct hashmap_entry *entries;
+    int size;
+    int *slots;
+};
+
+// Creates an empty map
+struct hashmap *hashmap_new();
+// Releases a reference to a map, freeing it once it has no others
+void hashmap_release(struct hashmap *map);
+// Copies a map along with its keys and values
+struct hashmap *hashmap_copy(struct hashmap *map);
+// Wraps a map in a new value, which takes over the caller's reference
+struct value *hashmap_value(struct hashmap *map);
+
+// Finds the value for a key, which the map continues to own, or NULL if
+// there isn't one
+struct value *hashmap_get(struct hashmap *map, struct value *key);
+// Sets the value for a key, taking ownership of both.  A key that's
+// already there keeps its place and its value is replaced.
+void hashmap_put(struct hashmap *map, struct value *key,
+                 struct value *value);
+// Checks whether two maps have the same keys with equal values, in any
+// order
+int hashmap_equal(struct hashmap *a, struct hashmap *b);
+// Makes a sequence of pairs of each key and its value, in order
+struct value *hashmap_pairs(struct hashmap *map);
+
+#endif // HASHMAP_H
@@ -0,0 +1,465 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "image.h"
+#include "interpreter.h"
+#include "symtable.h"
+#include "list.h"
+#include "buffer.h"
+#include "hash.h"
+#include "file.h"
+
+#define IMAGE_SIGNATURE "\x7f" "COL"
+#define IMAGE_SIGNATURE_SIZE 4
+#define IMAGE_VERSION 2
+
+// No arguments at all, as opposed to an empty argument list
+#define IMAGE_NO_ARGS 0xffffffff
+
+// Position in an image being read, error is set on any overrun
+struct image_reader
+{
+    const char *cursor;
+    const char *end;
+    int error;
+};
+
+// Returns non-zero if a buffer starts with the image file signature
+int image_check(const char *data, size_t length);
+
+// Encoding functions
+void image_put(struct buffer *out, const void *data, size_t length);
+void image_put_u8(struct buffer *out, uint8_t n);
+void image_put_u32(struct buffer *out, uint32_t n);
+void image_put_string(struct buffer *out, const char *s);
+void image_put_function(struct buffer *out, struct function *function);
+void image_put_value(struct buffer *out, struct value *value);
+
+// Decoding functions
+int image_get(struct image_reader *in, void *data, size_t length);
+uint8_t image_get_u8(struct image_reader *in);
+uint32_t image_get_u32(struct image_reader *in);
+char *image_get_string(struct image_reader *in);
+struct function *image_get_function(struct image_reader *in);
+struct value *image_get_value(struct image_reader *in);
+
+// Returns non-zero if a file starts with the image file signature
+int image_detect(const char *path)
+{
+    char signature[IMAGE_SIGNATURE_SIZE];
+    FILE *fin = fopen(path, "rb");
+    size_t length = 0;
+
+    if(!fin)
+        return 0;
+
+    length = fread(signature, 1, IMAGE_SIGNATURE_SIZE, fin);
+    fclose(fin);
+    return image_check(signature, length);
+}
+
+// Returns non-zero if a buffer starts with the image file signature
+int image_check(const char *data, size_t length)
+{
+    return length >= IMAGE_SIGNATURE_SIZE
+        && !memcmp(data, IMAGE_SIGNATURE, IMAGE_SIGNATURE_SIZE);
+}
+
+// Writes the definitions in a symtable to an image file
+int image_write(struct symtable *table, const char *source, size_t length,
+                const char *source_path, const char *image_path)
+{
+    int written = 0;
+    uint32_t count = 0;
+    uint64_t source_hash = hash_bytes(source, length);
+    struct buffer *out = buffer_new();
+    struct buffer *definitions = buffer_new();
+    struct symtable_entry *entry = NULL;
+    FILE *fout = NULL;
+
+    for(entry = symtable_next(table, NULL)
+            ; entry
+            ; entry = symtable_next(table, entry))
+    {
+        image_put_string(definitions, entry->name);
+        image_put_function(definitions, entry->data);
+        count++;
+    }
+
+    // Header followed by the definitions
+    image_put(out, IMAGE_SIGNATURE, IMAGE_SIGNATURE_SIZE);
+    image_put_u32(out, IMAGE_VERSION);
+    image_put(out, &source_hash, sizeof(source_hash));
+    image_put_string(out, source_path);
+    image_put_u32(out, count);
+    image_put(out, definitions->data, definitions->length);
+
+    fout = fopen(image_path, "wb");
+    if(fout)
+    {
+        written = fwrite(out->data, 1, out->length, fout) == out->length;
+        written = !fclose(fout) && written;
+    }
+
+    buffer_delete(definitions);
+    buffer_delete(out);
+    return written;
+}
+
+// Reads an image file, returns a linked symtable or NULL on error
+struct symtable *image_read(const char *image_path)
+{
+    int stale = 0;
+    uint32_t i, count;
+    uint64_t source_hash;
+    char *source_path = NULL;
+    char *name = NULL;
+    struct file_data *data = NULL;
+    struct file_data *source = NULL;
+    struct image_reader in;
+    struct function *function = NULL;
+    struct symtable *table = NULL;
+
+    data = read_file(image_path);
+    if(!data)
+        return NULL;
+
+    in.cursor = data->data;
+    in.end = in.cursor + data->length;
+    in.error = 0;
+
+    // Checking the header
+    if(!image_check(in.cursor, data->length))
+    {
+        file_data_delete(data);
+        return NULL;
+    }
+    in.cursor += IMAGE_SIGNATURE_SIZE;
+
+    if(image_get_u32(&in) != IMAGE_VERSION)
+    {
+        printf("Error: Unsupported program image version\n");
+        file_data_delete(data);
+        return NULL;
+    }
+
+    image_get(&in, &source_hash, sizeof(source_hash));
+    source_path = image_get_string(&in);
+    count = image_get_u32(&in);
+
+    // Refusing the image if its source has changed since it was compiled
+    if(!in.error && (source = read_file(source_path)))
+    {
+        stale = hash_bytes(source->data, source->length) != source_hash;
+        file_data_delete(source);
+    }
+
+    if(stale)
+    {
+        printf("Error: Program image is out of date with %s\n", source_path);
+        free(source_path);
+        file_data_delete(data);
+        return NULL;
+    }
+
+    // Reading the definitions
+    table = symtable_new();
+    for(i = 0; i < count && !in.error; i++)
+    {
+        name = image_get_string(&in);
+        function = image_get_function(&in);
+        if(name && function)
+            symtable_add(table, name, function);
+        else if(function)
+            function_delete(function);
+        free(name);
+    }
+
+    free(source_path);
+    file_data_delete(data);
+
+    if(in.error)
+    {
+        printf("Error: Corrupt program image\n");
+        symtable_delete(table);
+        return NULL;
+    }
+
+    symtable_link(table);
+    return table;
+}
+
+void image_put(struct buffer *out, const void *data, size_t length)
+{
+    buffer_append(out, (const char*)data, length);
+}
+
+void image_put_u8(struct buffer *out, uint8_t n)
+{
+    image_put(out, &n, sizeof(n));
+}
+
+void image_put_u32(struct buffer *out, uint32_t n)
+{
+    image_put(out, &n, sizeof(n));
+}
+
+void image_put_string(struct buffer *out, const char *s)
+{
+    uint32_t length = strlen(s);
+    image_put_u32(out, length);
+    image_put(out, s, length);
+}
+
+void image_put_function(struct buffer *out, struct function *function)
+{
+    struct cursor *c = NULL;
+
+    // Built-in functions are stored by their stable ID, which survives
+    // changes to the library, and looked up again on load
+    image_put_u8(out, function->type);
+    if(function->type == USER)
+        image_put_string(out, function->name);
+    else
+        image_put_u32(out, function_id(function));
+    image_put_u32(out, function->line);
+    image_put_u32(out, function->col);
+
+    if(!function->args)
+    {
+        image_put_u32(out, IMAGE_NO_ARGS);
+        return;
+    }
+
+    image_put_u32(out, function->args->count);
+    for(c = cursor_new_front(function->args); cursor_valid(c); cursor_next(c))
+    {
+        if(function->type == FORM)
+            image_put_function(out, (struct function*)cursor_get(c));
+        else
+            image_put_value(out, (struct value*)cursor_get(c));
+    }
+    cursor_delete(c);
+}
+
+void image_put_value(struct buffer *out, struct value *value)
+{
+    struct cursor *c = NULL;
+
+    // Constants come from the parser, which never makes streams, thunks,
+    // arrays or maps, but one turning up anyway is stored as bottom rather
+    // than as something image_get_value would reject
+    if(value->type == STREAM_VAL || value->type == THUNK_VAL
+       || value->type == ARRAY_VAL || value->type == MAP_VAL)
+        image_put_u8(out, BOTTOM_VAL);
+    else
+        image_put_u8(out, value->type);
+
+    switch(value->type)
+    {
+    case INT_VAL:
+        image_put(out, &value->data.int_val, sizeof(value->data.int_val));
+        break;
+    case FLOAT_VAL:
+        image_put(out, &value->data.float_val, sizeof(value->data.float_val));
+        break;
+    case CHAR_VAL:
+        image_put(out, &value->data.char_val, sizeof(value->data.char_val));
+        break;
+    case BOOL_VAL:
+        image_put_u8(out, value->data.bool_val);
+        break;
+    case STRING_VAL:
+        image_put_string(out, string_text(&value->data.str_val));
+        break;
+    case BOTTOM_VAL:
+    case STREAM_VAL:
+    case THUNK_VAL:
+    case ARRAY_VAL:
+    case MAP_VAL:
+        break;
+    case SEQ_VAL:
+        image_put_u32(out, value->data.seq_val->count);
+        for(c = cursor_new_front(value->data.seq_val)
+                ; cursor_valid(c)
+                ; cursor_next(c))
+            image_put_value(out, (struct value*)cursor_get(c));
+        cursor_delete(c);
+        break;
+    }
+}
+
+int image_get(struct image_reader *in, void *data, size_t length)
+{
+    if(in->error || length > (size_t)(in->end - in->cursor))
+    {
+        in->error = 1;
+        memset(data, 0, length);
+        return 0;
+    }
+
+    memcpy(data, in->cursor, length);
+    in->cursor += length;
+    return 1;
+}
+
+uint8_t image_get_u8(struct image_reader *in)
+{
+    uint8_t n;
+    image_get(in, &n, sizeof(n));
+    return n;
+}
+
+uint32_t image_get_u32(struct image_reader *in)
+{
+    uint32_t n;
+    image_get(in, &n, sizeof(n));
+    return n;
+}
+
+char *image_get_string(struct image_reader *in)
+{
+    char *s = NULL;
+    uint32_t length = image_get_u32(in);
+
+    if(in->error || length > (size_t)(in->end - in->cursor))
+    {
+        in->error = 1;
+        return NULL;
+    }
+
+    s = (char*)malloc(length + 1);
+    image_get(in, s, length);
+    s[length] = '\0';
+    return s;
+}
+
+struct function *image_get_function(struct image_reader *in)
+{
+    uint32_t i, count;
+    uint8_t type = image_get_u8(in);
+    void *arg = NULL;
+    struct function *function = function_new();
+
+    function->type = USER;
+    if(type == USER)
+    {
+        function->name = image_get_string(in);
+
+        // User definitions can't have since been shadowed by built-ins
+        if(function->name)
+            function_classify(function);
+    }
+    else if(!function_classify_id(function, image_get_u32(in)))
+    {
+        in->error = 1;
+    }
+    function->line = image_get_u32(in);
+    function->col = image_get_u32(in);
+
+    // Built-ins have to resolve to the same kind of function they were
+    if(!function->name || function->type != type || in->error)
+    {
+        in->error = 1;
+        function_delete(function);
+        return NULL;
+    }
+
+    count = image_get_u32(in);
+    if(count == IMAGE_NO_ARGS || in->error)
+        return function;
+
+    function->args = list_new();
+    for(i = 0; i < count && !in->error; i++)
+    {
+        if(function->type == FORM)
+            arg = image_get_function(in);
+        else
+            arg = image_get_value(in);
+
+        if(arg)
+            list_push_back(function->args, arg);
+    }
+
+    return function;
+}
+
+struct value *image_get_value(struct image_reader *in)
+{
+    uint32_t i, count;
+    char *s = NULL;
+    struct value *value = value_new();
+    struct value *element = NULL;
+
+    value->type = image_get_u8(in);
+
+    switch(value->type)
+    {
+    case INT_VAL:
+        image_get(in, &value->data.int_val, sizeof(value->data.int_val));
+        break;
+    case FLOAT_VAL:
+        image_get(in, &value->data.float_val, sizeof(value->data.float_val));
+        break;
+    case CHAR_VAL:
+        image_get(in, &value->data.char_val, sizeof(value->data.char_val));
+        break;
+    case BOOL_VAL:
+        value->data.bool_val = image_get_u8(in);
+        break;
+    case STRING_VAL:
+        // Strings in images are constants, so they're interned
+        s = image_get_string(in);
+        if(!s)
+        {
+            value->type = BOTTOM_VAL;
+            value_delete(value);
+            return NULL;
+        }
+        string_intern(&value->data.str_val, s, strlen(s));
+        free(s);
+        break;
+    case BOTTOM_VAL:
+        break;
+    case SEQ_VAL:
+        count = image_get_u32(in);
+        value->data.seq_val = list_new();
+        for(i = 0; i < count && !in->error; i++)
+        {
+            element = image_get_value(in);
+            if(element)
+                list_push_back(value->data.seq_val, element);
+        }
+        break;
+    default:
+        in->error = 1;
+        value->type = BOTTOM_VAL;
+        value_delete(value);
+        return NULL;
+    }
+
+    return value;
+}
@@ -0,0 +1,49 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+
+struct symtable;
+
+/**
+ * A program image (.colc file) holds every definition of a parsed
+ * program in a compact binary form, so that it can be loaded without
+ * lexing or parsing the source again.  The image records the path and
+ * a hash of the source it was compiled from.  If that source still
+ * exists and no longer matches the hash, the image is refused as
+ * stale.
+ *
+ * Images are written in the byte order of the machine that compiled
+ * them, and are only meant to be loaded by the same build of col.
+ */
+
+// Returns non-zero if a file starts with the image file signature
+int image_detect(const char *path);
+// Writes the definitions in a symtable to an image file
+int image_write(struct symtable *table, const char *source, size_t length,
+                const char *source_path, const char *image_path);
+// Reads an image file, returns a linked symtable or NULL on error
+struct symtable *image_read(const char *image_path);
+
+#endif // IMAGE_H
@@ -0,0 +1,123 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "intern.h"
+#include "hash.h"
+
+struct intern_entry
+{
+    uint64_t hash;
+    int length;
+    char *text;
+};
+
+struct intern_table
+{
+    int size;
+    int count;
+    struct intern_entry *entries;
+};
+
+struct intern_table INTERNED = {0, 0, NULL};
+pthread_mutex_t INTERN_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+// Returns the slot holding a string, or the empty slot where it would go
+struct intern_entry *intern_slot(const char *text, int length,
+                                 uint64_t hash);
+// Doubles the number of slots in the table, or creates it
+void intern_grow();
+
+// Returns the interned copy of a string of the given length
+const char *intern(const char *text, int length)
+{
+    uint64_t hash = hash_bytes(text, length);
+    struct intern_entry *entry = NULL;
+    char *retval = NULL;
+
+    pthread_mutex_lock(&INTERN_LOCK);
+
+    if((INTERNED.count + 1) * 100 > INTERNED.size * INTERN_MAX_LOAD)
+        intern_grow();
+
+    entry = intern_slot(text, length, hash);
+    if(!entry->text)
+    {
+        entry->hash = hash;
+        entry->length = length;
+        entry->text = (char*)malloc(length + 1);
+        memcpy(entry->text, text, length);
+        entry->text[length] = '\0';
+        INTERNED.count++;
+    }
+    retval = entry->text;
+
+    pthread_mutex_unlock(&INTERN_LOCK);
+    return retval;
+}
+
+// Returns the slot holding a string, or the empty slot where it would go
+struct intern_entry *intern_slot(const char *text, int length,
+                                 uint64_t hash)
+{
+    int mask = INTERNED.size - 1;
+    int i = hash & mask;
+    struct intern_entry *entry = NULL;
+
+    for(;; i = (i + 1) & mask)
+    {
+        entry = INTERNED.entries + i;
+        if(!entry->text
+           || (entry->hash == hash && entry->length == length
+               && !memcmp(entry->text, text, length)))
+            return entry;
+    }
+}
+
+// Doubles the number of slots in the table, or creates it
+void intern_grow()
+{
+    int i, j;
+    int old_size = INTERNED.size;
+    int mask;
+    struct intern_entry *old = INTERNED.entries;
+
+    INTERNED.size = old_size ? old_size * 2 : INTERN_START_SIZE;
+    INTERNED.entries = (struct intern_entry*)
+        calloc(INTERNED.size, sizeof(struct intern_entry));
+    mask = INTERNED.size - 1;
+
+    for(i = 0; i < old_size; i++)
+    {
+        if(!old[i].text)
+            continue;
+
+        for(j = old[i].hash & mask; INTERNED.entries[j].text; j = (j + 1) & mask)
+            ;
+        INTERNED.entries[j] = old[i];
+    }
+
+    free(old);
+}
@@ -0,0 +1,38 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#define INTERN_START_SIZE 256 // Initial number of slots, a power of two
+#define INTERN_MAX_LOAD 75    // Percentage of slots used before growing
+
+/**
+ * Process-wide table of interned strings.  Each distinct string is stored
+ * once and never freed, so interned strings are equal exactly when their
+ * pointers are.  Used for string constants, which are copied every time
+ * the function holding them runs.  Safe to use from multiple threads.
+ */
+
+// Returns the interned copy of a string of the given length
+const char *intern(const char *text, int length);
+
+#endif // INTERN_H
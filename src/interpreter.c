@@ -27,9 +27,15 @@
 #include "symtable.h"
 #include "primitives.h"
 #include "forms.h"
-
-// Global symtable is initially NULL, initialized in main.c
-struct symtable *SYMTABLE = NULL;
+#include "buffer.h"
+#include "hash.h"
+#include "intern.h"
+#include "format.h"
+#include "stream.h"
+#include "optimizer.h"
+#include "stack.h"
+#include "array.h"
+#include "hashmap.h"
 
 // List of primitive functions, empty string at end marks end of list
 char *PRIMITIVE_FUNCTION_NAMES[] = 
@@ -55,6 +61,29 @@ struct value*(*FUNCTIONAL_FORMS[])(struct list*, struct value*) =
     #include "gen/form_defs.h"
 };
 
+// Perfect hash table of built-in names, generated by gendoc.py
+struct builtin BUILTINS[] =
+{
+    #include "gen/builtin_table.h"
+};
+
+// Displacement for each bucket of the perfect hash table, or -(slot + 1)
+// for buckets holding a single name
+int BUILTIN_DISPLACEMENTS[] =
+{
+    #include "gen/builtin_displacements.h"
+};
+
+#define BUILTIN_COUNT (sizeof(BUILTINS) / sizeof(BUILTINS[0]))
+
+// Picks a slot for an ID with a displacement
+uint32_t builtin_slot(uint32_t id, int displacement);
+// Releases a reference to a thunk, freeing it with the last one
+void thunk_release(struct thunk *thunk);
+// Runs a conditional marked FUNCTION_CONS as a loop, defined in forms.c
+// but kept out of forms.h, which only declares forms
+struct value *iff_cons(struct function *function, struct value *in);
+
 // Creates an empty function struct
 struct function *function_new()
 {
@@ -63,6 +92,10 @@ struct function *function_new()
     retval->index = 0;
     retval->name = NULL;
     retval->args = NULL;
+    retval->definition = NULL;
+    retval->flags = 0;
+    retval->line = 0;
+    retval->col = 0;
     return retval;
 }
 // Deletes a function struct
@@ -107,20 +140,33 @@ struct value *value_new()
 // Deletes a value struct
 void value_delete(struct value *value)
 {
-    struct cursor *c = NULL;
+    struct list_node *node = NULL;
 
     if(value->type == SEQ_VAL && value->data.seq_val)
     {
-        for(c = cursor_new_front(value->data.seq_val)
-                ; cursor_valid(c)
-                ; cursor_next(c))
-            value_delete((struct value*)cursor_get(c));
+        for(node = value->data.seq_val->front; node; node = node->next)
+            value_delete((struct value*)node->data);
         list_delete(value->data.seq_val);
-        cursor_delete(c);
     }
     else if(value->type == STRING_VAL)
     {
-        free(value->data.str_val);
+        string_free(&value->data.str_val);
+    }
+    else if(value->type == STREAM_VAL)
+    {
+        stream_release(value->data.stream_val);
+    }
+    else if(value->type == THUNK_VAL)
+    {
+        thunk_release(value->data.thunk_val);
+    }
+    else if(value->type == ARRAY_VAL)
+    {
+        array_release(value->data.array_val);
+    }
+    else if(value->type == MAP_VAL)
+    {
+        hashmap_release(value->data.map_val);
     }
 
     free(value);
@@ -130,22 +176,39 @@ void value_delete(struct value *value)
 struct value *value_copy(struct value *val)
 {
     struct value *retval = value_new();
-    struct cursor *c = NULL;
+    struct list_node *node = NULL;
     
     retval->type = val->type;
     if(val->type == SEQ_VAL)
     {
         // Copying the sequence
         retval->data.seq_val = list_new();
-        for(c = cursor_new_front(val->data.seq_val)
-                ; cursor_valid(c)
-                ; cursor_next(c))
-            list_push_back(retval->data.seq_val, value_copy(cursor_get(c)));
-        cursor_delete(c);
+        for(node = val->data.seq_val->front; node; node = node->next)
+            list_push_back(retval->data.seq_val, value_copy(node->data));
     }
     else if(val->type == STRING_VAL)
     {
-        retval->data.str_val = strdup(val->data.str_val);
+        string_copy(&retval->data.str_val, &val->data.str_val);
+    }
+    else if(val->type == STREAM_VAL)
+    {
+        retval->data.stream_val = stream_copy(val->data.stream_val);
+    }
+    else if(val->type == THUNK_VAL)
+    {
+        retval->data.thunk_val = val->data.thunk_val;
+        retval->data.thunk_val->refs++;
+    }
+    else if(val->type == ARRAY_VAL)
+    {
+        // Arrays are never modified, so copies can share them
+        retval->data.array_val = val->data.array_val;
+        retval->data.array_val->refs++;
+    }
+    else if(val->type == MAP_VAL)
+    {
+        retval->data.map_val = val->data.map_val;
+        retval->data.map_val->refs++;
     }
     else
     {
@@ -155,27 +218,347 @@ struct value *value_copy(struct value *val)
     return retval;
 }
 
+// Returns the text of a string
+const char *string_text(struct string *s)
+{
+    return s->length < STRING_INLINE_SIZE ? s->text.buf : s->text.ptr;
+}
+
+// Sets a string to a copy of some text
+void string_init(struct string *s, const char *text, int length)
+{
+    char *dest = s->text.buf;
+
+    s->length = length;
+    s->interned = 0;
+    if(length >= STRING_INLINE_SIZE)
+        dest = s->text.ptr = (char*)malloc(length + 1);
+
+    memcpy(dest, text, length);
+    dest[length] = '\0';
+}
+
+// Sets a string to some text allocated with malloc, taking ownership of it
+void string_take(struct string *s, char *text, int length)
+{
+    if(length < STRING_INLINE_SIZE)
+    {
+        string_init(s, text, length);
+        free(text);
+        return;
+    }
+
+    s->length = length;
+    s->interned = 0;
+    s->text.ptr = text;
+}
+
+// Sets a string to the interned copy of some text
+void string_intern(struct string *s, const char *text, int length)
+{
+    // Short strings are cheaper to copy than to share
+    if(length < STRING_INLINE_SIZE)
+    {
+        string_init(s, text, length);
+        return;
+    }
+
+    s->length = length;
+    s->interned = 1;
+    s->text.ptr = (char*)intern(text, length);
+}
+
+// Copies a string, sharing the text if it's interned
+void string_copy(struct string *dest, struct string *src)
+{
+    if(src->interned)
+        *dest = *src;
+    else
+        string_init(dest, string_text(src), src->length);
+}
+
+// Frees the text of a string, if it's owned
+void string_free(struct string *s)
+{
+    if(s->length >= STRING_INLINE_SIZE && !s->interned)
+        free(s->text.ptr);
+}
+
+// Checks two strings for equality
+int string_equal(struct string *a, struct string *b)
+{
+    // Interned text is unique, so the pointers decide
+    if(a->interned && b->interned)
+        return a->text.ptr == b->text.ptr;
+
+    return a->length == b->length
+        && !memcmp(string_text(a), string_text(b), a->length);
+}
+
+// Orders two strings, returning -1, 0, or 1 like a sign of strcmp
+int string_compare(struct string *a, struct string *b)
+{
+    int shorter = a->length < b->length ? a->length : b->length;
+    int result = 0;
+
+    if(a->interned && b->interned && a->text.ptr == b->text.ptr)
+        return 0;
+
+    result = memcmp(string_text(a), string_text(b), shorter);
+    if(!result)
+        result = a->length - b->length;
+
+    return result < 0 ? -1 : result > 0;
+}
+
 // Checks a value for bottom, including lists
 int value_is_bottom(struct value *val)
 {
-    struct cursor *c = NULL;
+    struct list_node *node = NULL;
 
     if(val->type == BOTTOM_VAL)
         return 1;
 
+    if(val->type == THUNK_VAL)
+        return val->data.thunk_val->result
+            && value_is_bottom(val->data.thunk_val->result);
+
     if(val->type == SEQ_VAL)
-    {
-        for(c = cursor_new_front(val->data.seq_val)
-                ; cursor_valid(c)
-                ; cursor_next(c))
-            if(value_is_bottom(cursor_get(c)))
+        for(node = val->data.seq_val->front; node; node = node->next)
+            if(value_is_bottom(node->data))
                 return 1;
-        cursor_delete(c);
-    }
 
     return 0;
 }
 
+// Checks two values for equality, element by element for sequences
+int value_equal(struct value *a, struct value *b)
+{
+    struct list_node *na = NULL;
+    struct list_node *nb = NULL;
+
+    if(a->type != b->type)
+        return 0;
+
+    switch(a->type)
+    {
+    case INT_VAL:
+        return a->data.int_val == b->data.int_val;
+    case FLOAT_VAL:
+        return a->data.float_val == b->data.float_val;
+    case BOOL_VAL:
+        return a->data.bool_val == b->data.bool_val;
+    case CHAR_VAL:
+        return a->data.char_val == b->data.char_val;
+    case BOTTOM_VAL:
+        return 0;
+    case STRING_VAL:
+        return string_equal(&a->data.str_val, &b->data.str_val);
+    case ARRAY_VAL:
+        return array_equal(a->data.array_val, b->data.array_val);
+    case MAP_VAL:
+        return hashmap_equal(a->data.map_val, b->data.map_val);
+    case SEQ_VAL:
+        if(a->data.seq_val->count != b->data.seq_val->count)
+            return 0;
+
+        for(na = a->data.seq_val->front, nb = b->data.seq_val->front
+                ; na && nb
+                ; na = na->next, nb = nb->next)
+        {
+            if(!value_equal(na->data, nb->data))
+                return 0;
+        }
+        return 1;
+    default:
+        return 1;
+    }
+}
+
+// Hashes a value by its contents, so equal values hash the same
+uint64_t value_hash(struct value *value)
+{
+    uint64_t h = hash_mix(value->type);
+    uint64_t entries = 0;
+    struct list_node *node = NULL;
+    struct array *array = NULL;
+    struct hashmap *map = NULL;
+    float f;
+    uint32_t bits;
+    int i;
+
+    switch(value->type)
+    {
+    case INT_VAL:
+        return hash_combine(h, (uint32_t)value->data.int_val);
+    case FLOAT_VAL:
+        // Negative zero equals zero, so they need the same bits
+        f = value->data.float_val == 0 ? 0 : value->data.float_val;
+        memcpy(&bits, &f, sizeof(bits));
+        return hash_combine(h, bits);
+    case BOOL_VAL:
+        return hash_combine(h, (uint32_t)value->data.bool_val);
+    case CHAR_VAL:
+        return hash_combine(h, (unsigned char)value->data.char_val);
+    case STRING_VAL:
+        return hash_combine(h, hash_bytes(string_text(&value->data.str_val),
+                                          value->data.str_val.length));
+    case SEQ_VAL:
+        for(node = value->data.seq_val->front; node; node = node->next)
+            h = hash_combine(h, value_hash(node->data));
+        return h;
+    case ARRAY_VAL:
+        array = value->data.array_val;
+        h = hash_combine(h, array->is_float);
+        for(i = 0; i < array->rank; i++)
+            h = hash_combine(h, array->shape[i]);
+        for(i = 0; i < array->count; i++)
+        {
+            if(array->is_float)
+            {
+                f = array->data.floats[i] == 0 ? 0 : array->data.floats[i];
+                memcpy(&bits, &f, sizeof(bits));
+            }
+            else
+            {
+                bits = array->data.ints[i];
+            }
+            h = hash_combine(h, bits);
+        }
+        return h;
+    case MAP_VAL:
+        // Equal maps can list their entries in different orders, so the
+        // entries are added up instead of combined in turn
+        map = value->data.map_val;
+        for(i = 0; i < map->count; i++)
+            entries += hash_combine(map->entries[i].hash,
+                                    value_hash(map->entries[i].value));
+        return hash_combine(h, entries);
+    default:
+        return h;
+    }
+}
+
+// Creates a thunk deferring a function's evaluation, taking ownership of in
+struct value *thunk_new(struct function *function, struct value *in)
+{
+    struct value *value = value_new();
+    struct thunk *thunk = (struct thunk*)malloc(sizeof(struct thunk));
+
+    thunk->refs = 1;
+    thunk->function = function;
+    thunk->input = in;
+    thunk->result = NULL;
+
+    value->type = THUNK_VAL;
+    value->data.thunk_val = thunk;
+    return value;
+}
+
+// Returns the result of a thunk, which it continues to own, evaluating it
+// first if it hasn't been already
+struct value *thunk_result(struct thunk *thunk)
+{
+    if(!thunk->result)
+    {
+        thunk->result = stream_materialize(function_exec(thunk->function,
+                                                         thunk->input));
+        thunk->input = NULL;
+    }
+
+    return thunk->result;
+}
+
+// Releases a reference to a thunk, freeing it with the last one
+void thunk_release(struct thunk *thunk)
+{
+    if(--thunk->refs > 0)
+        return;
+
+    if(thunk->input)
+        value_delete(thunk->input);
+    if(thunk->result)
+        value_delete(thunk->result);
+    free(thunk);
+}
+
+// Replaces thunks with their results in place, throughout any sequences
+// if deep is set, returns nonzero if there were any
+int value_force(struct value *value, int deep)
+{
+    struct value *result = NULL;
+    struct list_node *node = NULL;
+    int forced = 0;
+
+    if(value->type == THUNK_VAL)
+    {
+        result = value_copy(thunk_result(value->data.thunk_val));
+        thunk_release(value->data.thunk_val);
+
+        // Moving the copy's contents into place
+        *value = *result;
+        free(result);
+        forced = 1;
+    }
+
+    if(deep && value->type == SEQ_VAL)
+        for(node = value->data.seq_val->front; node; node = node->next)
+            forced |= value_force((struct value*)node->data, 1);
+
+    return forced;
+}
+
+// Replaces arrays with the nested sequences they hold and maps with
+// sequences of their key and value pairs, in place, throughout any
+// sequences
+void value_unpack(struct value *value)
+{
+    struct value *unpacked = NULL;
+    struct list_node *node = NULL;
+
+    if(value->type == ARRAY_VAL)
+    {
+        unpacked = array_unpack(value->data.array_val);
+        array_release(value->data.array_val);
+
+        // Moving the sequence into place
+        *value = *unpacked;
+        free(unpacked);
+    }
+    else if(value->type == MAP_VAL)
+    {
+        unpacked = hashmap_pairs(value->data.map_val);
+        hashmap_release(value->data.map_val);
+        *value = *unpacked;
+        free(unpacked);
+
+        // Keys and values can hold arrays and maps of their own
+        value_unpack(value);
+    }
+    else if(value->type == SEQ_VAL)
+    {
+        for(node = value->data.seq_val->front; node; node = node->next)
+            value_unpack(node->data);
+    }
+}
+
+// Materializes streams, forces thunks and unpacks arrays and maps, so that
+// a value can leave the interpreter, consuming the value
+struct value *value_resolve(struct value *value)
+{
+    value = stream_materialize(value);
+    value_force(value, 1);
+
+    if(value_is_bottom(value))
+    {
+        value_delete(value);
+        return value_new();
+    }
+
+    value_unpack(value);
+    return value;
+}
+
 // Prints a text representation of a function
 void function_print(struct function *function, int level)
 {
@@ -257,7 +640,7 @@ void value_print(struct value *value, int level)
         break;
 
     case STRING_VAL:
-        printf("\"%s\" (String)\n", value->data.str_val);
+        printf("\"%s\" (String)\n", string_text(&value->data.str_val));
         break;
 
     case BOOL_VAL:
@@ -280,91 +663,384 @@ void value_print(struct value *value, int level)
         cursor_delete(c);
         break;
 
+    case STREAM_VAL:
+        printf("Stream\n");
+        break;
+
+    case THUNK_VAL:
+        printf("Thunk\n");
+        break;
+
+    case ARRAY_VAL:
+        printf("Array\n");
+        break;
+
+    case MAP_VAL:
+        printf("Map\n");
+        break;
+
     default:
         printf("Unknown value type %d\n", value->type);
         break;
     }
 }
 
+// Writes a value to a buffer in the syntax of a col constant
+void value_serialize(struct value *value, struct buffer *out)
+{
+    char buf[FORMAT_FLOAT_SIZE];
+    const char *s = NULL;
+    int first = 1;
+    struct cursor *c = NULL;
+    struct value *element = NULL;
+
+    switch(value->type)
+    {
+    case INT_VAL:
+        buffer_append(out, buf, format_int(buf, value->data.int_val));
+        break;
+
+    case FLOAT_VAL:
+        buffer_append(out, buf, format_float(buf, value->data.float_val));
+        break;
+
+    case CHAR_VAL:
+        buffer_append_char(out, '\'');
+        if(value->data.char_val == '\'' || value->data.char_val == '\\')
+            buffer_append_char(out, '\\');
+
+        if(value->data.char_val == '\n')
+            buffer_append_str(out, "\\n");
+        else if(value->data.char_val == '\t')
+            buffer_append_str(out, "\\t");
+        else
+            buffer_append_char(out, value->data.char_val);
+        buffer_append_char(out, '\'');
+        break;
+
+    case STRING_VAL:
+        buffer_append_char(out, '"');
+        for(s = string_text(&value->data.str_val); *s; s++)
+        {
+            switch(*s)
+            {
+            case '"':
+                buffer_append_str(out, "\\\"");
+                break;
+            case '\\':
+                buffer_append_str(out, "\\\\");
+                break;
+            case '\n':
+                buffer_append_str(out, "\\n");
+                break;
+            case '\t':
+                buffer_append_str(out, "\\t");
+                break;
+            default:
+                buffer_append_char(out, *s);
+                break;
+            }
+        }
+        buffer_append_char(out, '"');
+        break;
+
+    case BOOL_VAL:
+        buffer_append_str(out, value->data.bool_val ? "true" : "false");
+        break;
+
+    case BOTTOM_VAL:
+        buffer_append_str(out, "bottom");
+        break;
+
+    case SEQ_VAL:
+        buffer_append_char(out, '<');
+        for(c = cursor_new_front(value->data.seq_val)
+                ; cursor_valid(c)
+                ; cursor_next(c))
+        {
+            if(!first)
+                buffer_append_str(out, ", ");
+            first = 0;
+            value_serialize((struct value*)cursor_get(c), out);
+        }
+        cursor_delete(c);
+        buffer_append_char(out, '>');
+        break;
+
+    case STREAM_VAL:
+        // Streams are written as the sequence they produce, consuming them
+        buffer_append_char(out, '<');
+        while((element = stream_next(value->data.stream_val)))
+        {
+            if(!first)
+                buffer_append_str(out, ", ");
+            first = 0;
+            value_serialize(element, out);
+            value_delete(element);
+        }
+        buffer_append_char(out, '>');
+        break;
+
+    case THUNK_VAL:
+        value_serialize(thunk_result(value->data.thunk_val), out);
+        break;
+
+    case ARRAY_VAL:
+        // Arrays are written as the nested sequences they were made from
+        element = array_unpack(value->data.array_val);
+        value_serialize(element, out);
+        value_delete(element);
+        break;
+
+    case MAP_VAL:
+        // Maps are written as the sequence of pairs they could be made from
+        element = hashmap_pairs(value->data.map_val);
+        value_serialize(element, out);
+        value_delete(element);
+        break;
+    }
+}
+
 // Prints a text representation of all the functions in a symtable
 void symtable_print(struct symtable *table)
 {
-    int i = 0;
-    struct list *l;
-    struct cursor *c = NULL;
     struct symtable_entry *e = NULL;
 
     // Just iterating through the symtable and printing each entry
     // Not in any particular order, thanks to the hashing
-    for(i = 0; i < SYMTABLE_SIZE; i++)
+    for(e = symtable_next(table, NULL); e; e = symtable_next(table, e))
     {
-        l = table->entries[i];
-        for(c = cursor_new_front(l); cursor_valid(c); cursor_next(c))
-        {
-            e = cursor_get(c);
-            
-            printf("%s = \n", e->name);
-            function_print(e->data, 0);
-            printf("\n");
-        }
+        printf("%s = \n", e->name);
+        function_print(e->data, 0);
+        printf("\n");
+    }
+}
+
+// Sets a function's type and index according to its name
+void function_classify(struct function *function)
+{
+    int length = strlen(function->name);
+    struct builtin *builtin =
+        builtin_find(hash_bytes32(function->name, length));
+
+    // A matching ID still has to be checked against the name itself
+    if(builtin
+       && builtin->length == length
+       && !memcmp(builtin->name, function->name, length))
+    {
+        function->type = builtin->type;
+        function->index = builtin->index;
+    }
+    else
+    {
+        function->type = USER;
+    }
+}
+
+// Sets a built-in function's name, type, and index according to its stable
+// ID, returns 0 if no built-in has that ID
+int function_classify_id(struct function *function, uint32_t id)
+{
+    struct builtin *builtin = builtin_find(id);
+
+    if(!builtin)
+        return 0;
+
+    free(function->name);
+    function->name = strdup(builtin->name);
+    function->type = builtin->type;
+    function->index = builtin->index;
+    return 1;
+}
+
+// Returns the stable ID of a built-in function
+uint32_t function_id(struct function *function)
+{
+    return hash_bytes32(function->name, strlen(function->name));
+}
+
+// Finds a built-in function by its stable ID, returns NULL if there isn't one
+struct builtin *builtin_find(uint32_t id)
+{
+    int displacement = BUILTIN_DISPLACEMENTS[id % BUILTIN_COUNT];
+    uint32_t slot;
+
+    if(displacement < 0)
+        slot = -displacement - 1;
+    else
+        slot = builtin_slot(id, displacement);
+
+    return BUILTINS[slot].id == id ? &BUILTINS[slot] : NULL;
+}
+
+// Picks a slot for an ID with a displacement, must match gendoc.py
+uint32_t builtin_slot(uint32_t id, int displacement)
+{
+    uint32_t h = (id ^ displacement) * 2654435761U;
+    h ^= h >> 16;
+    return h % BUILTIN_COUNT;
+}
+
+// Resolves user-defined function references against a symtable
+void function_link(struct function *function, struct symtable *table)
+{
+    struct cursor *c = NULL;
+
+    if(function->type == USER)
+    {
+        function->definition = symtable_find(table, function->name);
+    }
+    else if(function->type == FORM && function->args)
+    {
+        for(c = cursor_new_front(function->args)
+                ; cursor_valid(c)
+                ; cursor_next(c))
+            function_link((struct function*)cursor_get(c), table);
         cursor_delete(c);
     }
 }
 
+// Checks whether a function can take streams and thunks without forcing
+// them, because it never looks at sequence elements
+int function_lazy_input(struct function *function)
+{
+    struct value *(*f)(struct list*, struct value*) = NULL;
+
+    if(function->type != PRIMITIVE)
+        return 1;
+
+    f = PRIMITIVE_FUNCTIONS[function->index];
+    return f == head || f == tail || f == length || f == id;
+}
+
 // Executes a function, always returns a new value object
 struct value *function_exec(struct function *function, struct value *in)
 {
     struct value *out = NULL;
+    struct value *(*form)(struct list*, struct value*) = NULL;
 
-    // Check for bottom, in which case there's no need to do anything
-    if(value_is_bottom(in))
-    {
-        value_delete(in);
-        return value_new();
-    }
+    // Deep recursion carries on in a fresh stack segment
+    if(STACK_LOW(&out))
+        return stack_exec(function, in);
 
-    switch(function->type)
+    // Calls in tail position go around the loop again instead of
+    // recursing, so they take no extra stack
+    for(;;)
     {
-    case USER:
-        // For user functions, just look up the function in the symtable and 
-        // execute it, or return bottom if it's not found
-        function = symtable_find(SYMTABLE, function->name);
-        if(function)
+        // A thunk given directly is needed whole
+        if(in->type == THUNK_VAL)
+            value_force(in, 0);
+
+        // Check for bottom, in which case there's no need to do anything
+        if(value_is_bottom(in))
         {
-            out = function_exec(function,  in);
+            value_delete(in);
+            return value_new();
         }
-        else
+
+        switch(function->type)
         {
-            out = value_new();
+        case USER:
+            // For user functions, just execute the definition resolved at
+            // link time, or return bottom if it wasn't found
+            function = function->definition;
+            if(function)
+                continue;
+
             value_delete(in);
-        }   
-        break;
-        
-    case FORM:
-        // For functional forms, get the apropriate function pointer from the 
-        // table and pass it the input
-        out = (*FUNCTIONAL_FORMS[function->index])(function->args, in);
+            return value_new();
 
-        if(value_is_bottom(out))
-        {
-            value_delete(out);
-            out = value_new();
+        case FORM:
+            form = FUNCTIONAL_FORMS[function->index];
+
+            // The outermost function of a composition and the chosen
+            // branch of a conditional are in tail position
+            if(form == compose)
+            {
+                function = compose_tail(function->args, &in);
+                if(function)
+                    continue;
+                return in;
+            }
+            else if(form == iff)
+            {
+                // Recursion that conses onto its own result runs as a loop
+                if(function->flags & FUNCTION_CONS)
+                    return iff_cons(function, in);
+
+                function = iff_tail(function->args, &in);
+                if(function)
+                    continue;
+                return value_new();
+            }
+            else if(form == unfold && (function->flags & FUNCTION_STREAM)
+                    && function->args->count == 3)
+            {
+                return stream_unfold(in, list_get(function->args, 0),
+                                     list_get(function->args, 1),
+                                     list_get(function->args, 2));
+            }
+
+            // For other functional forms, get the apropriate function
+            // pointer from the table and pass it the input
+            out = form(function->args, in);
+
+            if(value_is_bottom(out))
+            {
+                value_delete(out);
+                out = value_new();
+            }
+            return out;
+
+        case PRIMITIVE:
+            // Most primitives need a whole sequence at once
+            if(in->type == STREAM_VAL && !function_lazy_input(function))
+            {
+                in = stream_materialize(in);
+                if(value_is_bottom(in))
+                {
+                    value_delete(in);
+                    return value_new();
+                }
+            }
+
+            out = primitive_exec(function, in);
+            value_delete(in);
+            return out;
         }
-        break;
 
-    case PRIMITIVE:
-        // For primitive functions, get the function pointer from the table, 
-        // pass it the input, return result
-        out = (*PRIMITIVE_FUNCTIONS[function->index])(function->args, in);
         value_delete(in);
-        
-        if(value_is_bottom(out))
-        {
-            value_delete(out);
-            out = value_new();
-        }
-        break;
+        return value_new();
     }
+}
 
+// Runs a primitive on an input that remains owned by the caller, so the
+// same input value can be filled in and used again
+struct value *primitive_exec(struct function *function, struct value *in)
+{
+    struct value *out = NULL;
+
+    // Primitives need each element of their input as well, any that turn
+    // out to be bottom make it bottom
+    if(OPTIMIZER_DEFERS && !function_lazy_input(function)
+       && value_force(in, 1) && value_is_bottom(in))
+    {
+        return value_new();
+    }
+
+    // For primitive functions, get the function pointer from the table,
+    // pass it the input, return result
+    out = (*PRIMITIVE_FUNCTIONS[function->index])(function->args, in);
+
+    // Elements passed straight through, by head for instance, are needed
+    // whole now
+    if(out->type == THUNK_VAL)
+        value_force(out, 0);
+
+    if(value_is_bottom(out))
+    {
+        value_delete(out);
+        out = value_new();
+    }
     return out;
 }
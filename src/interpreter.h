@@ -21,10 +21,21 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <stdint.h>
+
 #define INDENT_STEP 2 // Number of spaces to indent each level for debug
+#define STRING_INLINE_SIZE 16 // Strings shorter than this are stored inline
+
+#define FUNCTION_IMPURE 1 // Function flag, running it can perform I/O
+#define FUNCTION_DEFER 2  // Function flag, a construct element to defer
+#define FUNCTION_CONS 4   // Function flag, an if that conses onto recursion
+#define FUNCTION_STREAM 8 // Function flag, an unfold that produces a stream
 
 struct symtable;
 struct list;
+struct buffer;
+struct stream;
+struct hashmap;
 
 // List of primitive functions
 extern char *PRIMITIVE_FUNCTION_NAMES[];
@@ -33,9 +44,6 @@ extern struct value*(*PRIMITIVE_FUNCTIONS[])(struct list*, struct value*);
 extern char *FUNCTIONAL_FORM_NAMES[];
 extern struct value*(*FUNCTIONAL_FORMS[])(struct list*, struct value*);
 
-// Global symtable
-extern struct symtable *SYMTABLE;
-
 // Data types
 enum value_type
 {
@@ -45,7 +53,11 @@ enum value_type
     STRING_VAL, // String
     BOOL_VAL,   // Boolean
     BOTTOM_VAL, // Bottom
-    SEQ_VAL     // Sequence
+    SEQ_VAL,    // Sequence
+    STREAM_VAL, // Lazily generated sequence
+    THUNK_VAL,  // Deferred construct element
+    ARRAY_VAL,  // Packed numeric array
+    MAP_VAL     // Hash map
 };
 
 // Types of function
@@ -56,6 +68,20 @@ enum function_type
     FORM       // Functional form
 };
 
+// A string that knows its length.  The text is always null-terminated,
+// and is stored inside the struct itself if it's short enough.
+struct string
+{
+    int length;
+    // Set if the text is shared in the intern table and mustn't be freed
+    int interned;
+    union
+    {
+        char *ptr;
+        char buf[STRING_INLINE_SIZE];
+    } text;
+};
+
 // The type and content of a value
 struct value
 {
@@ -69,11 +95,41 @@ struct value
         float float_val;
         int bool_val;
         char char_val;
-        char *str_val;
+        struct string str_val;
         struct list *seq_val;
+        struct stream *stream_val;
+        struct thunk *thunk_val;
+        struct array *array_val;
+        struct hashmap *map_val;
     } data;
 };
 
+// A construct element whose evaluation has been deferred until a
+// primitive needs it.  Copies share the thunk, so it's evaluated at most
+// once.  Thunks only appear as elements of sequences, function_exec
+// forces any it's given directly.
+struct thunk
+{
+    int refs;
+    struct function *function;
+    // Input to the function, freed once it's been evaluated
+    struct value *input;
+    // Result of the function, NULL until it's been evaluated
+    struct value *result;
+};
+
+// Entry in the perfect hash table of built-in function names
+struct builtin
+{
+    char *name;
+    int length;
+    enum function_type type;
+    // Index into function/name array
+    int index;
+    // Stable ID, the 32-bit FNV-1a hash of the name
+    uint32_t id;
+};
+
 // Representation of a function definition of any type
 struct function
 {
@@ -85,6 +141,10 @@ struct function
     struct list *args;
     // Index into function/name array if primitive or functional form
     int index;
+    // Definition of a user-defined function, filled in by function_link
+    struct function *definition;
+    // FUNCTION_ flags, filled in by the optimizer
+    int flags;
 
     // Location in source file
     int line;
@@ -102,17 +162,75 @@ struct value *value_new();
 void value_delete(struct value *value);
 // Copies a value struct, including any lists
 struct value *value_copy(struct value *val);
-// Checks a value for bottom, including lists
+// Checks a value for bottom, including lists but not streams or
+// unevaluated thunks
 int value_is_bottom(struct value *val);
+// Checks two values for equality, element by element for sequences.
+// Values of different types are never equal, and neither is bottom.
+int value_equal(struct value *a, struct value *b);
+// Hashes a value by its contents, so equal values hash the same
+uint64_t value_hash(struct value *value);
+
+// Creates a thunk deferring a function's evaluation, taking ownership of in
+struct value *thunk_new(struct function *function, struct value *in);
+// Returns the result of a thunk, which it continues to own, evaluating it
+// first if it hasn't been already
+struct value *thunk_result(struct thunk *thunk);
+// Replaces thunks with their results in place, throughout any sequences
+// if deep is set, returns nonzero if there were any
+int value_force(struct value *value, int deep);
+// Replaces arrays with the nested sequences they hold and maps with
+// sequences of their key and value pairs, in place, throughout any
+// sequences
+void value_unpack(struct value *value);
+// Materializes streams, forces thunks and unpacks arrays and maps, so that
+// a value can leave the interpreter, consuming the value
+struct value *value_resolve(struct value *value);
+
+// Returns the text of a string
+const char *string_text(struct string *s);
+// Sets a string to a copy of some text
+void string_init(struct string *s, const char *text, int length);
+// Sets a string to some text allocated with malloc, taking ownership of it
+void string_take(struct string *s, char *text, int length);
+// Sets a string to the interned copy of some text
+void string_intern(struct string *s, const char *text, int length);
+// Copies a string, sharing the text if it's interned
+void string_copy(struct string *dest, struct string *src);
+// Frees the text of a string, if it's owned
+void string_free(struct string *s);
+// Checks two strings for equality
+int string_equal(struct string *a, struct string *b);
+// Orders two strings, returning -1, 0, or 1 like a sign of strcmp
+int string_compare(struct string *a, struct string *b);
 
 // Prints a text representation of a function
 void function_print(struct function *function, int level);
 // Prints a text representation of a value
 void value_print(struct value *value, int level);
+// Writes a value to a buffer in the syntax of a col constant
+void value_serialize(struct value *value, struct buffer *out);
 // Prints a text representation of all the functions in a symtable
 void symtable_print(struct symtable *table);
 
+// Sets a function's type and index according to its name
+void function_classify(struct function *function);
+// Sets a built-in function's name, type, and index according to its stable
+// ID, returns 0 if no built-in has that ID
+int function_classify_id(struct function *function, uint32_t id);
+// Returns the stable ID of a built-in function
+uint32_t function_id(struct function *function);
+// Finds a built-in function by its stable ID, returns NULL if there isn't one
+struct builtin *builtin_find(uint32_t id);
+// Resolves user-defined function references against a symtable
+void function_link(struct function *function, struct symtable *table);
+
+// Checks whether a function can take streams and thunks without forcing
+// them, because it never looks at sequence elements
+int function_lazy_input(struct function *function);
 // Executes a function, always returns a new value object
 struct value *function_exec(struct function *function, struct value *in);
+// Runs a primitive without consuming its input, which mustn't be a stream
+struct value *primitive_exec(struct function *function, struct value *in);
 
 #endif // INTERPRETER_H
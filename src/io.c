@@ -0,0 +1,308 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "io.h"
+
+struct io_output IO_STDOUT =
+{
+    STDOUT_FILENO, NULL, 0, 0, IO_FLUSH_DEFAULT, PTHREAD_MUTEX_INITIALIZER
+};
+
+struct io_output IO_STDERR =
+{
+    STDERR_FILENO, NULL, 0, 0, IO_FLUSH_LINE, PTHREAD_MUTEX_INITIALIZER
+};
+
+struct io_input IO_STDIN =
+{
+    STDIN_FILENO, NULL, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER
+};
+
+// Makes sure buffered output is written when the process exits
+pthread_once_t IO_EXIT_ONCE = PTHREAD_ONCE_INIT;
+
+// Registers io_flush_all to run at exit
+void io_register_exit();
+// Allocates a stream's buffer on first use, with the lock held
+void io_init(struct io_output *out);
+// Adds data to a stream's buffer, with the lock held
+void io_append(struct io_output *out, const char *data, int length);
+// Writes out a stream's buffer, with the lock held
+void io_drain(struct io_output *out);
+// Writes a block of data to a file descriptor, retrying short writes
+void io_write_fd(int fd, const char *data, int length);
+// Reads more input into a stream's buffer, returns 0 at the end of input
+int io_fill(struct io_input *in);
+
+// Sets the buffer size and flush policy of an output stream
+void io_configure(struct io_output *out, int size,
+                  enum io_flush_policy policy)
+{
+    pthread_mutex_lock(&out->lock);
+
+    io_drain(out);
+    free(out->data);
+    out->data = NULL;
+    out->size = size > 0 ? size : IO_DEFAULT_SIZE;
+    out->policy = policy;
+
+    pthread_mutex_unlock(&out->lock);
+}
+
+// Writes to an output stream
+void io_write(struct io_output *out, const char *data, int length)
+{
+    pthread_mutex_lock(&out->lock);
+
+    io_append(out, data, length);
+    if(out->policy == IO_FLUSH_LINE && memchr(data, '\n', length))
+        io_drain(out);
+
+    pthread_mutex_unlock(&out->lock);
+}
+
+// Writes to an output stream followed by a newline
+void io_write_line(struct io_output *out, const char *data, int length)
+{
+    pthread_mutex_lock(&out->lock);
+
+    io_append(out, data, length);
+    io_append(out, "\n", 1);
+    if(out->policy == IO_FLUSH_LINE)
+        io_drain(out);
+
+    pthread_mutex_unlock(&out->lock);
+}
+
+// Writes out anything buffered in an output stream
+void io_flush(struct io_output *out)
+{
+    pthread_mutex_lock(&out->lock);
+    io_drain(out);
+    pthread_mutex_unlock(&out->lock);
+}
+
+// Writes out everything buffered in both output streams
+void io_flush_all()
+{
+    io_flush(&IO_STDOUT);
+    io_flush(&IO_STDERR);
+}
+
+// Registers io_flush_all to run at exit
+void io_register_exit()
+{
+    atexit(io_flush_all);
+}
+
+// Allocates a stream's buffer on first use, with the lock held
+void io_init(struct io_output *out)
+{
+    pthread_once(&IO_EXIT_ONCE, io_register_exit);
+
+    if(!out->size)
+        out->size = IO_DEFAULT_SIZE;
+
+    if(out->policy == IO_FLUSH_DEFAULT)
+        out->policy = isatty(out->fd) ? IO_FLUSH_LINE : IO_FLUSH_BLOCK;
+
+    out->data = (char*)malloc(out->size);
+}
+
+// Adds data to a stream's buffer, with the lock held
+void io_append(struct io_output *out, const char *data, int length)
+{
+    if(!out->data)
+        io_init(out);
+
+    // Making room, or skipping the buffer entirely for large writes
+    if(out->length + length > out->size)
+    {
+        if(out->policy == IO_FLUSH_EXIT)
+        {
+            while(out->length + length > out->size)
+                out->size *= 2;
+            out->data = (char*)realloc(out->data, out->size);
+        }
+        else
+        {
+            io_drain(out);
+            if(length > out->size)
+            {
+                io_write_fd(out->fd, data, length);
+                return;
+            }
+        }
+    }
+
+    memcpy(out->data + out->length, data, length);
+    out->length += length;
+}
+
+// Writes out a stream's buffer, with the lock held
+void io_drain(struct io_output *out)
+{
+    if(!out->length)
+        return;
+
+    // Anything written through stdio has to come out first
+    fflush(out->fd == STDERR_FILENO ? stderr : stdout);
+
+    io_write_fd(out->fd, out->data, out->length);
+    out->length = 0;
+}
+
+// Writes a block of data to a file descriptor, retrying short writes
+void io_write_fd(int fd, const char *data, int length)
+{
+    ssize_t written;
+
+    while(length > 0)
+    {
+        written = write(fd, data, length);
+        if(written < 0 && errno == EINTR)
+            continue;
+
+        // Output that can't be written is dropped, as stdio would
+        if(written <= 0)
+            return;
+
+        data += written;
+        length -= written;
+    }
+}
+
+// Opens a file for buffered reading, returns NULL if it can't be opened
+struct io_input *io_input_open(const char *path)
+{
+    struct io_input *in = NULL;
+    int fd;
+
+    do
+    {
+        fd = open(path, O_RDONLY);
+    } while(fd < 0 && errno == EINTR);
+
+    if(fd < 0)
+        return NULL;
+
+    in = (struct io_input*)malloc(sizeof(struct io_input));
+    in->fd = fd;
+    in->data = NULL;
+    in->start = 0;
+    in->end = 0;
+    in->size = 0;
+    in->eof = 0;
+    pthread_mutex_init(&in->lock, NULL);
+    return in;
+}
+
+// Closes a file opened with io_input_open and frees its buffer
+void io_input_close(struct io_input *in)
+{
+    close(in->fd);
+    pthread_mutex_destroy(&in->lock);
+    free(in->data);
+    free(in);
+}
+
+// Reads a line without its newline, returns a pointer into the stream's
+// buffer that's valid until the next read, or NULL at the end of input.
+// The caller must hold the stream's lock.
+const char *io_read_line(struct io_input *in, int *length)
+{
+    char *line = NULL;
+    char *newline = NULL;
+    int searched = 0;
+
+    for(;;)
+    {
+        // Only the data that's new since the last search is searched
+        line = in->data + in->start;
+        newline = NULL;
+        if(in->end - in->start > searched)
+            newline = memchr(line + searched, '\n',
+                             in->end - in->start - searched);
+        if(newline)
+        {
+            *length = newline - line;
+            in->start += *length + 1;
+            return line;
+        }
+        searched = in->end - in->start;
+
+        if(!io_fill(in))
+            break;
+    }
+
+    // The last line needn't end with a newline
+    if(in->start == in->end)
+        return NULL;
+
+    line = in->data + in->start;
+    *length = in->end - in->start;
+    in->start = in->end;
+    return line;
+}
+
+// Reads more input into a stream's buffer, returns 0 at the end of input
+int io_fill(struct io_input *in)
+{
+    ssize_t bytes;
+
+    if(in->eof)
+        return 0;
+
+    // Moving unread data to the front, then making room to read into
+    if(in->start > 0)
+    {
+        memmove(in->data, in->data + in->start, in->end - in->start);
+        in->end -= in->start;
+        in->start = 0;
+    }
+
+    if(in->size - in->end < IO_READ_SIZE)
+    {
+        in->size = in->size ? in->size * 2 : IO_READ_SIZE * 2;
+        in->data = (char*)realloc(in->data, in->size);
+    }
+
+    do
+    {
+        bytes = read(in->fd, in->data + in->end, in->size - in->end);
+    } while(bytes < 0 && errno == EINTR);
+
+    if(bytes <= 0)
+    {
+        in->eof = 1;
+        return 0;
+    }
+
+    in->end += bytes;
+    return 1;
+}
@@ -0,0 +1,93 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef IO_H
+#define IO_H
+
+#include <pthread.h>
+
+#define IO_DEFAULT_SIZE 65536 // Default output buffer size in bytes
+#define IO_READ_SIZE 65536    // Minimum amount read from input at once
+
+// When buffered output is written out
+enum io_flush_policy
+{
+    IO_FLUSH_DEFAULT, // Line for terminals, block otherwise
+    IO_FLUSH_LINE,    // After every newline
+    IO_FLUSH_BLOCK,   // Whenever the buffer fills
+    IO_FLUSH_EXIT     // Only on exit or explicit flush, the buffer grows
+};
+
+// An interpreter-owned output stream, written straight to a file
+// descriptor.  Streams are shared by every thread, so each has a lock.
+struct io_output
+{
+    int fd;
+    char *data;
+    int length;
+    int size;
+    enum io_flush_policy policy;
+    pthread_mutex_t lock;
+};
+
+// An interpreter-owned input stream, read straight from a file
+// descriptor.  Unread data is kept between start and end.
+struct io_input
+{
+    int fd;
+    char *data;
+    int start;
+    int end;
+    int size;
+    int eof;
+    pthread_mutex_t lock;
+};
+
+// Buffered standard output and standard error
+extern struct io_output IO_STDOUT;
+extern struct io_output IO_STDERR;
+// Buffered standard input
+extern struct io_input IO_STDIN;
+
+// Sets the buffer size and flush policy of an output stream
+void io_configure(struct io_output *out, int size,
+                  enum io_flush_policy policy);
+
+// Writes to an output stream
+void io_write(struct io_output *out, const char *data, int length);
+// Writes to an output stream followed by a newline
+void io_write_line(struct io_output *out, const char *data, int length);
+// Writes out anything buffered in an output stream
+void io_flush(struct io_output *out);
+// Writes out everything buffered in both output streams
+void io_flush_all();
+
+// Opens a file for buffered reading, returns NULL if it can't be opened
+struct io_input *io_input_open(const char *path);
+// Closes a file opened with io_input_open and frees its buffer
+void io_input_close(struct io_input *in);
+
+// Reads a line without its newline, returns a pointer into the stream's
+// buffer that's valid until the next read, or NULL at the end of input.
+// The caller must hold the stream's lock.
+const char *io_read_line(struct io_input *in, int *length);
+
+#endif // IO_H
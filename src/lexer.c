@@ -18,13 +18,67 @@
  *
  **/
 
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <ctype.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "lexer.h"
 
+// The character at c, or a terminator past the end of the input
+#define CURRENT(state, c) ((c) < (state)->end ? *(c) : '\0')
+
+// Longest number that's converted without allocating
+#define NUMBER_BUF_SIZE 64
+
+// Character classes
+#define CHAR_SPACE  0x01 // Whitespace
+#define CHAR_DIGIT  0x02 // Decimal digit
+#define CHAR_IDENT  0x04 // Valid in an identifier
+#define CHAR_SINGLE 0x08 // Single-character token
+
+#define N 0
+#define S CHAR_SPACE
+#define D (CHAR_DIGIT | CHAR_IDENT)
+#define I CHAR_IDENT
+#define T CHAR_SINGLE
+
+// Class of every possible input byte
+const unsigned char CHAR_CLASSES[256] =
+{
+    N, N, N, N, N, N, N, N, N, S, S, S, S, S, N, N, // 00
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // 10
+    S, I, N, N, N, N, N, N, T, T, I, I, T, I, N, I, // 20
+    D, D, D, D, D, D, D, D, D, D, N, N, T, T, T, N, // 30
+    N, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, // 40
+    I, I, I, I, I, I, I, I, I, I, I, N, N, N, N, I, // 50
+    N, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, // 60
+    I, I, I, I, I, I, I, I, I, I, I, T, N, T, N, N, // 70
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // 80
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // 90
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // a0
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // b0
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // c0
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // d0
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, // e0
+    N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N  // f0
+};
+
+#undef N
+#undef S
+#undef D
+#undef I
+#undef T
+
+#define IS_SPACE(c) (CHAR_CLASSES[(unsigned char)(c)] & CHAR_SPACE)
+#define IS_DIGIT(c) (CHAR_CLASSES[(unsigned char)(c)] & CHAR_DIGIT)
+#define IS_IDENT(c) (CHAR_CLASSES[(unsigned char)(c)] & CHAR_IDENT)
+#define IS_SINGLE(c) (CHAR_CLASSES[(unsigned char)(c)] & CHAR_SINGLE)
+
 // Lexing functions
 void skip_whitespace(struct lexer_state *state);
 void skip_comment(struct lexer_state *state);
@@ -33,9 +87,10 @@ void lex_ident(struct lexer_state *state);
 void lex_char(struct lexer_state *state);
 void lex_string(struct lexer_state *state);
 
-// Character identification functions
-int is_single_char_token(char c);
-int is_valid_ident_char(char c);
+// Returns the number of spaces at the start of a run of input
+int count_spaces(const char *c, const char *end);
+// Checks whether the current token's text is exactly s
+int token_is(struct lexer_state *state, const char *s);
 
 // Creates a new lexer
 struct lexer_state *lexer_new()
@@ -46,25 +101,30 @@ struct lexer_state *lexer_new()
     retval->line = 0;
     retval->col = 0;
     retval->token_line = 0;
-    retval->token_line = 0;
+    retval->token_col = 0;
     retval->token_cursor = 0;
     retval->cursor = NULL;
+    retval->end = NULL;
     retval->type = NONE;
-    retval->value.sval = NULL;
+    retval->value.sval.start = NULL;
+    retval->value.sval.length = 0;
     retval->error = END_OF_INPUT;
     retval->open_seq = retval->open_spec = retval->open_form = 0;
 
     return retval;
 }
 
-// Initializes a lexer with a new input
-void lexer_init(struct lexer_state *state, char *input)
+// Initializes a lexer with a new input of the given length
+void lexer_init(struct lexer_state *state, const char *input,
+                size_t length)
 {
     state->line = state->col = state->token_line = state->token_col = 1;
     state->cursor = input;
+    state->end = input + length;
     state->token_cursor = input;
     state->type = NONE;
-    state->value.sval = NULL;
+    state->value.sval.start = NULL;
+    state->value.sval.length = 0;
     state->error = OK;
     state->open_seq = state->open_spec = state->open_form = 0;
 }
@@ -72,36 +132,30 @@ void lexer_init(struct lexer_state *state, char *input)
 // Deletes a lexer
 void lexer_delete(struct lexer_state *state)
 {
-    if(!state)
-        return;
-
-    if(state->type == IDENT || state->type == STRING)
-        free(state->value.sval);
     free(state);
 }
 
 // Attempts to lex one token
 void lex(struct lexer_state *state)
 {
+    char c;
+
     if(state->error != OK)
         return;
-    
-    // Clearing out any string data that may be left over
-    if(state->type == IDENT || state->type == STRING)
-        free(state->value.sval);
 
     // First making sure we have something to lex
     skip_whitespace(state);
 
     // Checking for possible comments
-    while(state->cursor[0] == '#')
+    while(CURRENT(state, state->cursor) == '#')
     {
         skip_comment(state);
         skip_whitespace(state);
     }
 
     // Checking for end of input
-    if(*(state->cursor) == '\0')
+    c = CURRENT(state, state->cursor);
+    if(c == '\0')
     {
         state->error = END_OF_INPUT;
         state->type = NONE;
@@ -114,9 +168,9 @@ void lex(struct lexer_state *state)
     state->token_cursor = state->cursor;
 
     // Checking for single-character tokens
-    if(is_single_char_token(*(state->cursor)))
+    if(IS_SINGLE(c))
     {
-        switch(*(state->cursor))
+        switch(c)
         {
         case '<':
             state->type = OPEN_SEQ;
@@ -164,31 +218,28 @@ void lex(struct lexer_state *state)
     }
 
     // Checking for possible numbers
-    if(isdigit(*(state->cursor))
-       || *(state->cursor) == '+'
-       || *(state->cursor) == '-'
-       || *(state->cursor) == '.')
+    if(IS_DIGIT(c) || c == '+' || c == '-' || c == '.')
     {
         lex_possible_number(state);
         return;
     }
     
     // Checking for identifiers
-    if(is_valid_ident_char(*(state->cursor)))
+    if(IS_IDENT(c))
     {
         lex_ident(state);
         return;
     }
 
     // Checking for characters
-    if(*(state->cursor) == '\'')
+    if(c == '\'')
     {
         lex_char(state);
         return;
     }
 
     // Checking for strings
-    if(*(state->cursor) == '"')
+    if(c == '"')
     {
         lex_string(state);
         return;
@@ -212,27 +263,80 @@ void lexer_rewind(struct lexer_state *state)
     state->type = NONE;
 }
 
+// Copies the text of an identifier or string token into a new string,
+// translating any escape sequences
+char *lexer_token_string(struct lexer_state *state)
+{
+    const char *c = state->value.sval.start;
+    const char *end = c + state->value.sval.length;
+    char *retval = (char*)malloc(state->value.sval.length + 1);
+    char *out = retval;
+
+    // Identifiers never contain escapes
+    if(state->type != STRING)
+    {
+        memcpy(retval, c, state->value.sval.length);
+        retval[state->value.sval.length] = '\0';
+        return retval;
+    }
+
+    // Escapes were already validated by lex_string
+    for(; c < end; c++)
+    {
+        if(*c != '\\')
+        {
+            *(out++) = *c;
+            continue;
+        }
+
+        c++;
+        switch(*c)
+        {
+        case 't':
+            *(out++) = '\t';
+            break;
+        case 'n':
+            *(out++) = '\n';
+            break;
+        default:
+            *(out++) = *c;
+            break;
+        }
+    }
+    *out = '\0';
+
+    return retval;
+}
+
 void skip_whitespace(struct lexer_state *state)
 {
-    char *c = state->cursor;
+    const char *c = state->cursor;
+    int spaces;
 
     // Only operate on valid state
     if(state->error != OK)
         return;
 
-    while(isspace(*c))
+    while(c < state->end && IS_SPACE(*c))
     {
-        if(*c == '\n')
+        if(*c == ' ')
+        {
+            // Indentation comes in runs, which are skipped in bulk
+            spaces = count_spaces(c, state->end);
+            state->col += spaces;
+            c += spaces;
+        }
+        else if(*c == '\n')
         {
             state->line++;
             state->col = 1;
+            c++;
         }
         else
         {
             state->col++;
+            c++;
         }
-        
-        c++;
     }
 
     state->cursor = c;
@@ -240,73 +344,73 @@ void skip_whitespace(struct lexer_state *state)
 
 void skip_comment(struct lexer_state *state)
 {
-    char *c = state->cursor;
-    while(*c != '\0' && *c != '\n')
-    {
-        c++;
-        state->col++;
-    }
+    const char *c = state->cursor;
+    const char *newline = memchr(c, '\n', state->end - c);
 
-    if(*c == '\n')
+    if(newline)
     {
-        c++;
+        state->cursor = newline + 1;
         state->col = 1;
         state->line++;
     }
-
-    state->cursor = c;
+    else
+    {
+        state->col += state->end - c;
+        state->cursor = state->end;
+    }
 }
 
 void lex_possible_number(struct lexer_state *state)
 {
-    char *c = state->cursor;
-    char *buf = NULL;
-    int i;
+    const char *c = state->cursor;
+    char small_buf[NUMBER_BUF_SIZE];
+    char *buf = small_buf;
+    int length;
     int floating_point = 0;
     int has_digits = 0;
 
-    if(*c == '+' || *c == '-')
+    if(CURRENT(state, c) == '+' || CURRENT(state, c) == '-')
         c++;
 
     // There must be at least one digit or a period to open with
-    if(!isdigit(*c) && *c != '.')
+    if(!IS_DIGIT(CURRENT(state, c)) && CURRENT(state, c) != '.')
     {
         lex_ident(state);
         return;
     }
 
-    if(isdigit(*c))
+    if(IS_DIGIT(CURRENT(state, c)))
         has_digits = 1;
 
     // Now scan any digits before the (optional) decimal point
-    while(isdigit(*c))
+    while(IS_DIGIT(CURRENT(state, c)))
         c++;
 
     // Checking for decimal point or non-numeric characters
-    if(*c == '.')
+    if(CURRENT(state, c) == '.')
     {
         floating_point = 1;
         c++;
-        if(isdigit(*c))
+        if(IS_DIGIT(CURRENT(state, c)))
             has_digits = 1;
     }
-    else if(is_valid_ident_char(*c))
+    else if(IS_IDENT(CURRENT(state, c)))
     {
         lex_ident(state);
         return;
     }
     
     // Reading any digits after the decimal point
-    while(isdigit(*c))
+    while(IS_DIGIT(CURRENT(state, c)))
         c++;
 
     // Checking for e, E, or non-numeric characters
-    if(*c == 'e' || *c == 'E')
+    if(CURRENT(state, c) == 'e' || CURRENT(state, c) == 'E')
     {
         c++;
         
         // If we've already had a . and there aren't any digits left, error out
-        if(floating_point && !isdigit(*c))
+        if(floating_point && !IS_DIGIT(CURRENT(state, c)))
         {
             state->error = UNRECOGNIZED_TOKEN;
             state->type = NONE;
@@ -316,14 +420,14 @@ void lex_possible_number(struct lexer_state *state)
         floating_point = 1;
 
         // Making sure there are digits
-        if(!isdigit(*c))
+        if(!IS_DIGIT(CURRENT(state, c)))
         {
             lex_ident(state);
             return;
         }
 
         // Now scanning past the post-E digits
-        while(isdigit(*c))
+        while(IS_DIGIT(CURRENT(state, c)))
             c++;
 
     }
@@ -336,10 +440,12 @@ void lex_possible_number(struct lexer_state *state)
         return;
     }
 
-    // Now grabbing the actual number
-    buf = (char*)calloc(c - state->cursor + 1, sizeof(char));
-    for(i = 0; i < c - state->cursor; i++)
-        buf[i] = state->cursor[i];
+    // Now grabbing the actual number, which needs terminating for atoi
+    length = c - state->cursor;
+    if(length >= NUMBER_BUF_SIZE)
+        buf = (char*)malloc(length + 1);
+    memcpy(buf, state->cursor, length);
+    buf[length] = '\0';
     
     // And reading it
     if(floating_point)
@@ -353,20 +459,19 @@ void lex_possible_number(struct lexer_state *state)
         state->value.ival = atoi(buf);
     }
 
-    free(buf);
-    state->col += c - state->cursor;
+    if(buf != small_buf)
+        free(buf);
+    state->col += length;
     state->cursor = c;
 
 }
 
 void lex_ident(struct lexer_state *state)
 {
-    char *c = state->cursor;
-    char *buf = NULL;
-    int i;
+    const char *c = state->cursor;
 
     // Error out on ineligible characters
-    if(!is_valid_ident_char(*c))
+    if(!IS_IDENT(CURRENT(state, c)))
     {
         state->error = UNRECOGNIZED_TOKEN;
         state->type = NONE;
@@ -374,46 +479,30 @@ void lex_ident(struct lexer_state *state)
     }
 
     // Catching all the eligible characters
-    while(is_valid_ident_char(*c))
+    while(c < state->end && IS_IDENT(*c))
         c++;
 
-    // Storing the ident
-    buf = (char*)calloc(c - state->cursor + 1, sizeof(char));
-    for(i = 0; i < c - state->cursor; i++)
-        buf[i] = state->cursor[i];
-
     // Setting state
+    state->type = IDENT;
+    state->value.sval.start = state->cursor;
+    state->value.sval.length = c - state->cursor;
     state->col += c - state->cursor;
     state->cursor = c;
-    state->type = IDENT;
-    state->value.sval = buf;
 
     // Now checking for reserved words
-    if(!strcmp(buf, "true"))
-    {
+    if(token_is(state, "true"))
         state->type = TRUE;
-        free(buf);
-    }
-
-    if(!strcmp(buf, "false"))
-    {
+    else if(token_is(state, "false"))
         state->type = FALSE;
-        free(buf);
-    }
-
-    if(!strcmp(buf, "bottom"))
-    {
+    else if(token_is(state, "bottom"))
         state->type = BOTTOM;
-        free(buf);
-    }
-
 }
 
 void lex_char(struct lexer_state *state)
 {
-    char *c = state->cursor;
+    const char *c = state->cursor;
     
-    if(*c != '\'')
+    if(CURRENT(state, c) != '\'')
     {
         state->error = UNRECOGNIZED_TOKEN;
         state->type = NONE;
@@ -425,14 +514,14 @@ void lex_char(struct lexer_state *state)
         c++;
     }
 
-    if(*c != '\\')
+    if(CURRENT(state, c) != '\\')
     {
-        state->value.cval = *c;
+        state->value.cval = CURRENT(state, c);
     }
     else
     {
         c++;
-        switch(*c)
+        switch(CURRENT(state, c))
         {
         case '\'':
             state->value.cval = '\'';
@@ -458,7 +547,7 @@ void lex_char(struct lexer_state *state)
     }
     
     c++;
-    if(*c != '\'')
+    if(CURRENT(state, c) != '\'')
     {
         state->error = UNRECOGNIZED_TOKEN;
         state->type = NONE;
@@ -475,12 +564,9 @@ void lex_char(struct lexer_state *state)
 
 void lex_string(struct lexer_state *state)
 {
-    char *c = state->cursor;
-    char *buf = NULL;
-    int count = 0;
-    int i, j;
+    const char *c = state->cursor;
 
-    if(*c != '"')
+    if(CURRENT(state, c) != '"')
     {
         state->error = UNRECOGNIZED_TOKEN;
         state->type = NONE;
@@ -491,18 +577,19 @@ void lex_string(struct lexer_state *state)
         c++;
     }
 
-    // Counting and verifying the characters in the string
-    while(*c != '"' && *c != '\0' && *c != '\n')
+    // Verifying the characters in the string
+    while(CURRENT(state, c) != '"'
+          && CURRENT(state, c) != '\0'
+          && CURRENT(state, c) != '\n')
     {
-        count++;
-        if(*c == '\\')
+        if(CURRENT(state, c) == '\\')
         {
             c++;
 
-            if(*c != '\\'
-               && *c != '"'
-               && *c != 't'
-               && *c != 'n')
+            if(CURRENT(state, c) != '\\'
+               && CURRENT(state, c) != '"'
+               && CURRENT(state, c) != 't'
+               && CURRENT(state, c) != 'n')
             {
                 state->error = UNRECOGNIZED_TOKEN;
                 state->type = NONE;
@@ -513,72 +600,52 @@ void lex_string(struct lexer_state *state)
         c++;
     }
 
-    if(*c != '"')
+    if(CURRENT(state, c) != '"')
     {
         state->error = UNRECOGNIZED_TOKEN;
         state->type = NONE;
         return;
     }
-    else
-    {
-        c++;
-    }
 
-    // Copying and setting final state
-    buf = (char*)calloc(count + 1, sizeof(char));
-    for(i = 1, j = 0; j < count; j++, i++)
-    {
-        if(state->cursor[i] == '\\')
-        {
-            i++;
-            switch(state->cursor[i])
-            {
-            case '\\':
-                buf[j] = '\\';
-                break;
-            case '"':
-                buf[j] = '"';
-                break;
-            case 't':
-                buf[j] = '\t';
-                break;
-            case 'n':
-                buf[j] = '\n';
-                break;
-            }
-        }
-        else
-        {
-            buf[j] = state->cursor[i];
-        }
-    }
+    // The token is the text between the quotes
+    state->type = STRING;
+    state->value.sval.start = state->cursor + 1;
+    state->value.sval.length = c - state->cursor - 1;
 
+    c++;
     state->col += c - state->cursor;
     state->cursor = c;
-    state->type = STRING;
-    state->value.sval = buf;
 }
 
-int is_single_char_token(char c)
+// Returns the number of spaces at the start of a run of input
+int count_spaces(const char *c, const char *end)
 {
-    return c == '<'
-        || c == '>'
-        || c == '('
-        || c == ')'
-        || c == '{'
-        || c == '}'
-        || c == ','
-        || c == '=';
+    const char *start = c;
+#ifdef __SSE2__
+    __m128i spaces = _mm_set1_epi8(' ');
+    unsigned int mask;
+
+    // Comparing sixteen characters at a time until one isn't a space
+    while(end - c >= 16)
+    {
+        mask = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)c), spaces));
+        if(mask != 0xffff)
+            return c - start + __builtin_ctz(~mask);
+        c += 16;
+    }
+#endif
+
+    while(c < end && *c == ' ')
+        c++;
+
+    return c - start;
 }
 
-int is_valid_ident_char(char c)
+// Checks whether the current token's text is exactly s
+int token_is(struct lexer_state *state, const char *s)
 {
-    return isalnum(c)
-        || c == '+'
-        || c == '-'
-        || c == '*'
-        || c == '/'
-        || c == '!'
-        || c == '_'
-        || c == '-';
+    int length = strlen(s);
+    return state->value.sval.length == length
+        && !memcmp(state->value.sval.start, s, length);
 }
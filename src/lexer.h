@@ -21,6 +21,8 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stddef.h>
+
 enum token_type
 {
     NONE,        // Used on error or beginning of input
@@ -42,12 +44,20 @@ enum token_type
     ASSIGN       // =
 };
 
+// The text of a token, pointing directly into the lexer's input.  For
+// strings this is the text between the quotes, escape sequences and all.
+struct token_slice
+{
+    const char *start;
+    int length;
+};
+
 union token_val
 {
     int ival;
     float fval;
     char cval;
-    char *sval;
+    struct token_slice sval;
 };
 
 enum lex_error
@@ -66,10 +76,11 @@ struct lexer_state
     // Position of last token
     int token_line;
     int token_col;
-    char *token_cursor;
+    const char *token_cursor;
 
-    // Current location in string
-    char *cursor;
+    // Current location in the input, and the end of the input
+    const char *cursor;
+    const char *end;
 
     // Details of the last lexed token
     enum token_type type;
@@ -86,8 +97,10 @@ struct lexer_state
 
 // Creates a new lexer
 struct lexer_state *lexer_new();
-// Initializes a lexer with a new input
-void lexer_init(struct lexer_state *state, char *input);
+// Initializes a lexer with a new input of the given length, which need
+// not be null-terminated
+void lexer_init(struct lexer_state *state, const char *input,
+                size_t length);
 // Deletes a lexer
 void lexer_delete(struct lexer_state *state);
 
@@ -96,4 +109,8 @@ void lex(struct lexer_state *state);
 // Rewinds so that the previous token will be lexed again (works only once)
 void lexer_rewind(struct lexer_state *state);
 
+// Copies the text of an identifier or string token into a new string,
+// translating any escape sequences
+char *lexer_token_string(struct lexer_state *state);
+
 #endif // LEXER_H
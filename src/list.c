@@ -186,17 +186,23 @@ void list_remove(struct list *list, int element)
             old = old->prev;
     }
 
-    if(old->prev)
-        old->prev->next = old->next;
+    list_remove_node(list, old);
+}
+
+// Removes a node from the list, freeing it but not its item
+void list_remove_node(struct list *list, struct list_node *node)
+{
+    if(node->prev)
+        node->prev->next = node->next;
     else
-        list->front = old->next;
+        list->front = node->next;
 
-    if(old->next)
-        old->next->prev = old->prev;
+    if(node->next)
+        node->next->prev = node->prev;
     else
-        list->back = old->prev;
+        list->back = node->prev;
 
-    free(old);
+    free(node);
     list->count--;
 }
 
@@ -60,6 +60,8 @@ void list_push_back(struct list *list, void *element);
 void *list_get(struct list *list, int element);
 // Removes an item from the list
 void list_remove(struct list *list, int element);
+// Removes a node from the list, freeing it but not its item
+void list_remove_node(struct list *list, struct list_node *node);
 
 // Returns a new cursor starting at the beginning of a list
 struct cursor *cursor_new_front(struct list *list);
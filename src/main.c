@@ -22,25 +22,31 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "list.h"
-#include "file.h"
-#include "lexer.h"
-#include "symtable.h"
-#include "parser.h"
-#include "interpreter.h"
+#include "col.h"
 
-#define USAGE "Usage: col [-v] <source file> [command-line arguments]\n"
+#define USAGE "Usage: col [-v] [--lazy] [--buffer <bytes>]\n" \
+    "           [--flush line|block|exit] [--stack <megabytes>]\n" \
+    "           <source file> [command-line arguments]\n" \
+    "       col [-v] [--lazy] --serve <socket> [--threads <n>] <source file>\n" \
+    "       col --compile <source file> -o <image file>\n"
 
-struct value *args_to_value(int argc, char *argv[]);
+struct col_value *args_to_value(int argc, char *argv[]);
 
 int main(int argc, char *argv[])
 {
     int verbose = 0;
-    char *input;
-    struct lexer_state *lexer = NULL;
-    struct value *args = NULL;
-    struct value *final = NULL;
-    struct function *user_main;
+    int threads = 0;
+    int compile = 0;
+    int lazy = 0;
+    int buffer_size = 0;
+    int stack = 0;
+    enum col_flush_policy flush = COL_FLUSH_DEFAULT;
+    char *socket = NULL;
+    char *output = NULL;
+    struct col_program *program = NULL;
+    struct col_value *args = NULL;
+    struct col_value *final = NULL;
+    struct col_function *user_main;
     
     // Checking presence of command-line arguments
     if(argc < 2)
@@ -52,48 +58,129 @@ int main(int argc, char *argv[])
     argc--;
     argv++;
 
-    // Checking for verbose flag
-    if(!strcmp(argv[0], "-v") || !strcmp(argv[0], "-V"))
+    // Reading flags up to the name of the source file
+    while(argc > 0 && argv[0][0] == '-' && argv[0][1])
     {
-        verbose = 1;
+        if(!strcmp(argv[0], "-v") || !strcmp(argv[0], "-V"))
+        {
+            verbose = 1;
+        }
+        else if(!strcmp(argv[0], "--lazy"))
+        {
+            lazy = 1;
+        }
+        else if(!strcmp(argv[0], "--serve") && argc > 1)
+        {
+            socket = argv[1];
+            argc--;
+            argv++;
+        }
+        else if(!strcmp(argv[0], "--threads") && argc > 1)
+        {
+            threads = atoi(argv[1]);
+            argc--;
+            argv++;
+        }
+        else if(!strcmp(argv[0], "--buffer") && argc > 1)
+        {
+            buffer_size = atoi(argv[1]);
+            argc--;
+            argv++;
+        }
+        else if(!strcmp(argv[0], "--stack") && argc > 1)
+        {
+            stack = atoi(argv[1]);
+            argc--;
+            argv++;
+        }
+        else if(!strcmp(argv[0], "--flush") && argc > 1)
+        {
+            if(!strcmp(argv[1], "line"))
+                flush = COL_FLUSH_LINE;
+            else if(!strcmp(argv[1], "block"))
+                flush = COL_FLUSH_BLOCK;
+            else if(!strcmp(argv[1], "exit"))
+                flush = COL_FLUSH_EXIT;
+            else
+            {
+                printf(USAGE);
+                return 1;
+            }
+            argc--;
+            argv++;
+        }
+        else if(!strcmp(argv[0], "--compile"))
+        {
+            compile = 1;
+        }
+        else if(!strcmp(argv[0], "-o") && argc > 1)
+        {
+            output = argv[1];
+            argc--;
+            argv++;
+        }
+        else
+        {
+            printf(USAGE);
+            return 1;
+        }
+
         argc--;
         argv++;
     }
 
-    if(verbose)
-        printf("Reading input file...\n");
-
-    // Reading the input file
-    input = read_file(argv[0]);
-    if(!input)
+    if(argc < 1)
     {
-        printf("Error reading input file\n");
+        printf(USAGE);
         return 1;
     }
-    argc--;
-    argv++;
 
-    if(verbose)
-        printf("Parsing function definitions...\n");
+    // Compiling writes an image instead of running anything
+    if(compile)
+    {
+        if(argc == 3 && !strcmp(argv[1], "-o"))
+            output = argv[2];
+        else if(argc != 1)
+            output = NULL;
+
+        if(!output)
+        {
+            printf(USAGE);
+            return 1;
+        }
+
+        return col_program_compile(argv[0], output) ? 0 : 1;
+    }
 
-    // Initializing the lexer
-    lexer = lexer_new();
-    lexer_init(lexer, input);
+    col_set_output(buffer_size, flush);
+    col_set_lazy(lazy);
+    col_set_stack_limit(stack);
 
-    // Feeding the input to the parser and getting the symtable
-    SYMTABLE = parse(lexer);
-    
-    if(!SYMTABLE)
+    if(verbose)
+        printf("Loading function definitions...\n");
+
+    // Reading and parsing the input file
+    program = col_program_load_file(argv[0]);
+    if(!program)
     {
-        free(input);
-        lexer_delete(lexer);
+        printf("Error loading input file\n");
         return 1;
     }
+    argc--;
+    argv++;
 
     if(verbose)
     {
         printf("Loaded function definitions:\n\n");
-        symtable_print(SYMTABLE);
+        col_program_print(program);
+    }
+
+    // In server mode, the program's functions are called by clients
+    if(socket)
+    {
+        col_serve(program, socket, threads);
+        col_program_delete(program);
+        return 1;
     }
 
     // Running the main function
@@ -102,55 +189,46 @@ int main(int argc, char *argv[])
     if(verbose)
     {
         printf("Command-line arguments:\n");
-        value_print(args, 0);
+        col_value_print(args);
         printf("\n");
     }
 
-    user_main = symtable_find(SYMTABLE, "main");
+    user_main = col_program_find(program, "main");
     if(user_main)
     {
-        final = function_exec(user_main, args);
+        final = col_call(user_main, args);
     }
     else
     {
         printf("Error: No main function defined\n");
-        free(input);
-        lexer_delete(lexer);
-        symtable_delete(SYMTABLE);
+        col_value_delete(args);
+        col_program_delete(program);
         return 1;
     }
     
+    // The program's own output comes before anything printed here
+    col_flush();
+
     if(verbose)
     {
         printf("Return value of main:\n");
-        value_print(final, 0);
+        col_value_print(final);
     }
 
     // Cleaning up
-    free(input);
-    lexer_delete(lexer);
-    symtable_delete(SYMTABLE);
+    col_value_delete(final);
+    col_program_delete(program);
     
     return 0;
 }
 
-struct value *args_to_value(int argc, char *argv[])
+struct col_value *args_to_value(int argc, char *argv[])
 {
-    struct value *args = value_new();
-    struct value *arg = NULL;
+    struct col_value *args = col_value_seq();
     int i;
     
-    args->type = SEQ_VAL;
-    args->data.seq_val = list_new();
-    
     for(i = 0; i < argc; i++)
-    {
-        arg = value_new();
-        arg->type = STRING_VAL;
-        arg->data.str_val = strdup(argv[i]);
-        
-        list_push_back(args->data.seq_val, arg);
-    }
+        col_seq_push(args, col_value_string(argv[i]));
 
     return args;
 }
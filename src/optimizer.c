@@ -0,0 +1,234 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "optimizer.h"
+#include "interpreter.h"
+#include "symtable.h"
+#include "list.h"
+#include "primitives.h"
+#include "forms.h"
+
+int OPTIMIZER_LAZY = 0;
+int OPTIMIZER_DEFERS = 0;
+
+// Marks a function impure if it can perform I/O, returns its flags.  User
+// functions are judged by their definitions' current marks.
+int optimize_purity(struct function *function);
+// Checks whether a primitive performs I/O
+int optimize_io(struct function *function);
+// Marks the pure elements of every construct in a function to be
+// deferred, and pure unfolds to produce streams
+void optimize_defer(struct function *function);
+// Fuses reduce{ r } composed directly with map{ f } into mapreduce{ r, f }
+// throughout a function, when neither r nor f performs I/O
+void optimize_fuse(struct function *function);
+// Checks whether a function is a form with the given number of arguments
+int optimize_is_form(struct function *function,
+                     struct value *(*form)(struct list*, struct value*),
+                     int count);
+
+// Analyzes every function in a linked symtable
+void optimize(struct symtable *table)
+{
+    struct symtable_entry *entry = NULL;
+    int changed = 1;
+    int before;
+
+    // A function is impure if it reaches I/O through any chain of calls,
+    // so marks are spread until they stop changing.  They only ever go
+    // from pure to impure, so this always finishes.
+    while(changed)
+    {
+        changed = 0;
+        for(entry = symtable_next(table, NULL)
+                ; entry
+                ; entry = symtable_next(table, entry))
+        {
+            before = entry->data->flags;
+            if(optimize_purity(entry->data) != before)
+                changed = 1;
+        }
+    }
+
+    // Reducing a mapped sequence doesn't need the sequence
+    for(entry = symtable_next(table, NULL)
+            ; entry
+            ; entry = symtable_next(table, entry))
+        optimize_fuse(entry->data);
+
+    // Recursive list builders are run as loops
+    for(entry = symtable_next(table, NULL)
+            ; entry
+            ; entry = symtable_next(table, entry))
+        if(entry->data->type == FORM
+           && FUNCTIONAL_FORMS[entry->data->index] == iff
+           && iff_cons_branch(entry->data))
+            entry->data->flags |= FUNCTION_CONS;
+
+    if(!OPTIMIZER_LAZY)
+        return;
+
+    for(entry = symtable_next(table, NULL)
+            ; entry
+            ; entry = symtable_next(table, entry))
+        optimize_defer(entry->data);
+}
+
+// Marks a function impure if it can perform I/O, returns its flags.  User
+// functions are judged by their definitions' current marks.
+int optimize_purity(struct function *function)
+{
+    struct cursor *c = NULL;
+
+    switch(function->type)
+    {
+    case PRIMITIVE:
+        if(optimize_io(function))
+            function->flags |= FUNCTION_IMPURE;
+        break;
+
+    case USER:
+        if(function->definition
+           && (function->definition->flags & FUNCTION_IMPURE))
+            function->flags |= FUNCTION_IMPURE;
+        break;
+
+    case FORM:
+        if(!function->args)
+            break;
+
+        for(c = cursor_new_front(function->args)
+                ; cursor_valid(c)
+                ; cursor_next(c))
+            if(optimize_purity(cursor_get(c)) & FUNCTION_IMPURE)
+                function->flags |= FUNCTION_IMPURE;
+        cursor_delete(c);
+        break;
+    }
+
+    return function->flags;
+}
+
+// Checks whether a primitive performs I/O
+int optimize_io(struct function *function)
+{
+    struct value *(*f)(struct list*, struct value*) =
+        PRIMITIVE_FUNCTIONS[function->index];
+
+    return f == print_str || f == println_str || f == eprint_str
+        || f == eprintln_str || f == flush || f == readln_str
+        || f == readlines_str || f == lines;
+}
+
+// Marks the pure elements of every construct in a function to be
+// deferred, and pure unfolds to produce streams
+void optimize_defer(struct function *function)
+{
+    struct function *element = NULL;
+    struct cursor *c = NULL;
+    int i = 1;
+
+    if(function->type != FORM || !function->args)
+        return;
+
+    if(FUNCTIONAL_FORMS[function->index] == unfold
+       && !(function->flags & FUNCTION_IMPURE))
+        function->flags |= FUNCTION_STREAM;
+
+    for(c = cursor_new_front(function->args)
+            ; cursor_valid(c)
+            ; cursor_next(c), i++)
+    {
+        element = cursor_get(c);
+        optimize_defer(element);
+
+        if(FUNCTIONAL_FORMS[function->index] != construct)
+            continue;
+
+        // Primitives are cheaper to run than to defer
+        if(element->flags & FUNCTION_IMPURE)
+        {
+            fprintf(stderr, "Warning: Element %d of construct at %d, %d "
+                    "performs I/O, so it won't be deferred\n",
+                    i, function->line, function->col);
+        }
+        else if(element->type != PRIMITIVE)
+        {
+            element->flags |= FUNCTION_DEFER;
+            OPTIMIZER_DEFERS = 1;
+        }
+    }
+    cursor_delete(c);
+}
+
+// Fuses reduce{ r } composed directly with map{ f } into mapreduce{ r, f }
+// throughout a function, when neither r nor f performs I/O
+void optimize_fuse(struct function *function)
+{
+    struct list_node *node = NULL;
+    struct function *reducer = NULL;
+    struct function *mapper = NULL;
+    int i;
+
+    if(function->type != FORM || !function->args)
+        return;
+
+    for(node = function->args->front; node; node = node->next)
+        optimize_fuse(node->data);
+
+    if(FUNCTIONAL_FORMS[function->index] != compose)
+        return;
+
+    // Composition runs its arguments from the back, so the map comes
+    // right after the reduce
+    for(i = 0; i + 1 < function->args->count; i++)
+    {
+        reducer = list_get(function->args, i);
+        mapper = list_get(function->args, i + 1);
+        if(!optimize_is_form(reducer, reduce, 1)
+           || !optimize_is_form(mapper, map, 1)
+           || (reducer->flags & FUNCTION_IMPURE)
+           || (mapper->flags & FUNCTION_IMPURE))
+            continue;
+
+        // The reduce becomes the mapreduce, taking over the map's argument
+        free(reducer->name);
+        reducer->name = strdup("mapreduce");
+        function_classify(reducer);
+        list_push_back(reducer->args, list_pop(mapper->args));
+
+        list_remove(function->args, i + 1);
+        function_delete(mapper);
+    }
+}
+
+// Checks whether a function is a form with the given number of arguments
+int optimize_is_form(struct function *function,
+                     struct value *(*form)(struct list*, struct value*),
+                     int count)
+{
+    return function->type == FORM && FUNCTIONAL_FORMS[function->index] == form
+        && function->args && function->args->count == count;
+}
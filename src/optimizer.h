@@ -0,0 +1,46 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+/**
+ * Analysis of linked programs.  Every function is marked impure if
+ * running it could perform I/O, directly or through any function it
+ * calls.  A pure reduce composed directly with a pure map is fused into
+ * a single mapreduce.  When lazy evaluation is on, the pure elements of
+ * each construct are marked to be deferred: construct wraps them in thunks
+ * that are only evaluated when a primitive needs their values.  Elements
+ * that perform I/O are always evaluated eagerly, and a warning is printed
+ * for each.  Pure unfolds produce streams rather than sequences.
+ */
+
+struct symtable;
+
+// Set if programs loaded from now on should defer construct elements
+extern int OPTIMIZER_LAZY;
+// Set once any loaded program has deferred construct elements
+extern int OPTIMIZER_DEFERS;
+
+// Analyzes every function in a linked symtable
+void optimize(struct symtable *table);
+
+#endif // OPTIMIZER_H
@@ -45,13 +45,13 @@ enum parser_error
 int require_token(struct lexer_state *lexer, enum token_type token);
 // Parses a function definition
 struct function *parse_function(struct lexer_state *lexer);
-// Parses a set of constant arguments
+// Parses a set of constant arguments, interning strings if intern is set
 struct list *parse_constant_args(struct lexer_state *lexer,
-                                 enum token_type close);
+                                 enum token_type close, int intern);
 // Parses a set of function arguments
 struct list *parse_function_args(struct lexer_state *lexer);
-// Parses a constant
-struct value *parse_constant(struct lexer_state *lexer);
+// Parses a constant, interning strings if intern is set
+struct value *parse_constant(struct lexer_state *lexer, int intern);
 
 // Deletes every value in a list
 void clear_value_list(struct list *args);
@@ -98,12 +98,13 @@ struct symtable *parse(struct lexer_state *lexer)
         }
 
         // Otherwise, grab the name
-        ident = strdup(lexer->value.sval);
+        ident = lexer_token_string(lexer);
 
         // Require the assign operator
         if(!require_token(lexer, ASSIGN))
         {
             print_error(lexer, EXPECTED_ASSIGN);
+            free(ident);
             error = 1;
             break;
         }
@@ -113,6 +114,7 @@ struct symtable *parse(struct lexer_state *lexer)
 
         if(!definition)
         {
+            free(ident);
             error = 1;
             break;
         }
@@ -156,8 +158,6 @@ int require_token(struct lexer_state *lexer, enum token_type token)
 // Parses a function definition
 struct function *parse_function(struct lexer_state *lexer)
 {
-    int error = 0;
-    int i = 0;
     struct function *function = NULL;
 
     // First getting the identifier
@@ -181,31 +181,14 @@ struct function *parse_function(struct lexer_state *lexer)
         return NULL;
     }
 
-    // Storing the identifier
+    // Storing the identifier and its location
     function = function_new();
-    function->name = strdup(lexer->value.sval);
+    function->name = lexer_token_string(lexer);
+    function->line = lexer->token_line;
+    function->col = lexer->token_col;
 
     // Figuring out what type of function this is
-    function->type = USER; // Until proven otherwise
-
-    // Checking against primitive and form lists
-    for(i = 0; *(PRIMITIVE_FUNCTION_NAMES[i]); i++)
-    {
-        if(!strcmp(PRIMITIVE_FUNCTION_NAMES[i], function->name))
-        {
-            function->type = PRIMITIVE;
-            function->index = i;
-        }
-    }
-    
-    for(i = 0; *(FUNCTIONAL_FORM_NAMES[i]); i++)
-    {
-        if(!strcmp(FUNCTIONAL_FORM_NAMES[i], function->name))
-        {
-            function->type = FORM;
-            function->index = i;
-        }
-    }
+    function_classify(function);
 
     // Now checking for possible arguments
     if(function->type == PRIMITIVE)
@@ -222,7 +205,8 @@ struct function *parse_function(struct lexer_state *lexer)
         // Now checking for opening paren
         if(lexer->error == OK && lexer->type == OPEN_SPEC)
         {
-            function->args = parse_constant_args(lexer, CLOSE_SPEC);
+            // Specializers are constant for the life of the program
+            function->args = parse_constant_args(lexer, CLOSE_SPEC, 1);
             if(!function->args)
             {
                 function_delete(function);
@@ -255,9 +239,9 @@ struct function *parse_function(struct lexer_state *lexer)
     return function;
 }
 
-// Parses a set of constant arguments
+// Parses a set of constant arguments, interning strings if intern is set
 struct list *parse_constant_args(struct lexer_state *lexer, 
-                                 enum token_type close)
+                                 enum token_type close, int intern)
 {
     struct value *arg = NULL;
     struct list *args = list_new();
@@ -288,11 +272,11 @@ struct list *parse_constant_args(struct lexer_state *lexer,
     while(lexer->error == OK)
     {        
         // First parse a value and add it to the list
-        arg = parse_constant(lexer);
+        arg = parse_constant(lexer, intern);
 
         if(!arg)
         {
-            clear_function_list(args);
+            clear_value_list(args);
             return NULL;
         }
 
@@ -380,10 +364,11 @@ struct list *parse_function_args(struct lexer_state *lexer)
     return args;
 }
 
-// Parses a constant
-struct value *parse_constant(struct lexer_state *lexer)
+// Parses a constant, interning strings if intern is set
+struct value *parse_constant(struct lexer_state *lexer, int intern)
 {
     struct value *arg = value_new();
+    char *s = NULL;
     
     // First grab the next token
     lex(lexer);
@@ -436,12 +421,21 @@ struct value *parse_constant(struct lexer_state *lexer)
 
     case STRING:
         arg->type = STRING_VAL;
-        arg->data.str_val = strdup(lexer->value.sval);
+        s = lexer_token_string(lexer);
+        if(intern)
+        {
+            string_intern(&arg->data.str_val, s, strlen(s));
+            free(s);
+        }
+        else
+        {
+            string_take(&arg->data.str_val, s, strlen(s));
+        }
         break;
         
     case OPEN_SEQ:
         arg->type = SEQ_VAL;
-        arg->data.seq_val = parse_constant_args(lexer, CLOSE_SEQ);
+        arg->data.seq_val = parse_constant_args(lexer, CLOSE_SEQ, intern);
         if(!arg->data.seq_val)
         {
             value_delete(arg);
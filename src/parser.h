@@ -23,8 +23,13 @@
 
 struct symtable;
 struct lexer_state;
+struct value;
 
 // Parses the output of a lexer, builds a symtable and returns it
 struct symtable *parse(struct lexer_state *lexer);
+// Parses a single constant from the output of a lexer, NULL on error.
+// Strings are interned if intern is set, which should only be done for
+// constants that live as long as the program.
+struct value *parse_constant(struct lexer_state *lexer, int intern);
 
 #endif // PARSER_H
@@ -25,8 +25,14 @@
 #include "list.h"
 #include "primitives.h"
 #include "interpreter.h"
+#include "format.h"
+#include "io.h"
+#include "stream.h"
+#include "array.h"
+#include "sort.h"
+#include "hashmap.h"
 
-#define STRING_BUF_SIZE 1024
+#define STRING_BUF_SIZE 64
 
 /*** +
  * Basic addition function.
@@ -459,62 +465,6 @@ struct value *id(struct list *args, struct value *in)
     return value_copy(in);
 }
 
-int _compare_values(struct value *a, struct value *b)
-{
-    struct list *la = NULL;
-    struct list *lb = NULL;
-    struct cursor *ca = NULL;
-    struct cursor *cb = NULL;
-
-    if(a->type != b->type)
-        return 0;
-
-    if(a->type == SEQ_VAL)
-    {
-        la = a->data.seq_val;
-        lb = b->data.seq_val;
-
-        if(la->count != lb->count)
-            return 0;
-
-        for(ca = cursor_new_front(la), cb = cursor_new_front(lb)
-                ; cursor_valid(ca) && cursor_valid(cb)
-                ; cursor_next(ca), cursor_next(cb))
-        {
-            if(!_compare_values(cursor_get(ca), cursor_get(cb)))
-            {
-                cursor_delete(ca);
-                cursor_delete(cb);
-                return 0;
-            }
-        }
-        cursor_delete(ca);
-        cursor_delete(cb);
-    }
-    else
-    {
-        switch(a->type)
-        {
-        case INT_VAL:
-            return a->data.int_val == b->data.int_val;
-        case FLOAT_VAL:
-            return a->data.float_val == b->data.float_val;
-        case BOOL_VAL:
-            return a->data.bool_val == b->data.float_val;
-        case CHAR_VAL:
-            return a->data.char_val == b->data.char_val;
-        case BOTTOM_VAL:
-            return 0;
-        case STRING_VAL:
-            return !strcmp(a->data.str_val, b->data.str_val);
-        case SEQ_VAL:
-            return 0;
-        }
-    }
-
-    return 1;
-}
-
 /*** eq
  * Comparison function.
  * Input - A sequence of two or more values.
@@ -543,7 +493,7 @@ struct value *eq(struct list *args, struct value *in)
 
     while(cursor_valid(c))
     {
-        if(!_compare_values(last, cursor_get(c)))
+        if(!value_equal(last, cursor_get(c)))
         {
             cursor_delete(c);
             return out;
@@ -626,7 +576,7 @@ int __order_values(struct value *a, struct value *b)
         if(b->type != STRING_VAL)
             return -2;
 
-        return strcmp(a->data.str_val, b->data.str_val);
+        return string_compare(&a->data.str_val, &b->data.str_val);
     default:
         return -2;
     }
@@ -847,7 +797,7 @@ struct value *gte(struct list *args, struct value *in)
  * truncated, integers are passed through verbatim.  True becomes 1, False
  * becomes 0.  Chars are converted to their ASCII values.  Strings are
  * converted with the C atoi function.  Sequences simply return the sequence
- * length.
+ * length.  Arrays and maps give bottom.
  */
 struct value *to_int(struct list *args, struct value *in)
 {
@@ -866,7 +816,7 @@ struct value *to_int(struct list *args, struct value *in)
         out->data.int_val = (int)in->data.char_val;
         break;
     case STRING_VAL:
-        out->data.int_val = atoi(in->data.str_val);
+        out->data.int_val = atoi(string_text(&in->data.str_val));
         break;
     case BOOL_VAL:
         out->data.int_val = in->data.bool_val ? 1 : 0;
@@ -874,6 +824,12 @@ struct value *to_int(struct list *args, struct value *in)
     case SEQ_VAL:
         out->data.int_val = in->data.seq_val->count;
         break;
+    case ARRAY_VAL:
+    case MAP_VAL:
+    case STREAM_VAL:
+    case THUNK_VAL:
+        value_delete(out);
+        return value_new();
     case BOTTOM_VAL:
         out->data.int_val = 0;
         break;
@@ -890,7 +846,7 @@ struct value *to_int(struct list *args, struct value *in)
  * passed through verbatim.  True becomes 1.0, False becomes 0.0.  Chars are
  * converted to their ASCII values and then cast to floating point.  Strings
  * are converted with the C atof funciton.  Sequences simply return the
- * sequence length.
+ * sequence length.  Arrays and maps give bottom.
  */
 struct value *to_float(struct list *args, struct value *in)
 {
@@ -909,7 +865,7 @@ struct value *to_float(struct list *args, struct value *in)
         out->data.float_val = (double)((int)in->data.char_val);
         break;
     case STRING_VAL:
-        out->data.float_val = atof(in->data.str_val);
+        out->data.float_val = atof(string_text(&in->data.str_val));
         break;
     case BOOL_VAL:
         out->data.float_val = in->data.bool_val ? 1.0 : 0.0;
@@ -917,6 +873,12 @@ struct value *to_float(struct list *args, struct value *in)
     case SEQ_VAL:
         out->data.float_val = (float)in->data.seq_val->count;
         break;
+    case ARRAY_VAL:
+    case MAP_VAL:
+    case STREAM_VAL:
+    case THUNK_VAL:
+        value_delete(out);
+        return value_new();
     case BOTTOM_VAL:
         out->data.float_val = 0.;
         break;
@@ -928,42 +890,72 @@ struct value *to_float(struct list *args, struct value *in)
 /*** str
  * String conversion function.
  * Input - Any value other than bottom.
- * Output - A conversion of the input value to a string.
+ * Output - A conversion of the input value to a string.  Floating point
+ * numbers are written with the fewest digits that read back as the same
+ * number, and always with a decimal point, as in 2.0 or 0.1.  Numbers of
+ * 1e21 and up are written in scientific notation, as in 1.5e21.
  */
 struct value *to_string(struct list *args, struct value *in)
 {
+    char buf[STRING_BUF_SIZE];
+    int length = 0;
+    int i;
     struct value *out = value_new();
     out->type = STRING_VAL;
-    out->data.str_val = (char*)malloc(sizeof(char) * STRING_BUF_SIZE);
 
     switch(in->type)
     {
     case INT_VAL:
-        snprintf(out->data.str_val, 1024, "%d", in->data.int_val);
+        length = format_int(buf, in->data.int_val);
         break;
     case FLOAT_VAL:
-        snprintf(out->data.str_val, 1024, "%lf", in->data.float_val);
+        length = format_float(buf, in->data.float_val);
         break;
     case CHAR_VAL:
-        snprintf(out->data.str_val, 1024, "%c", in->data.char_val);
+        length = snprintf(buf, STRING_BUF_SIZE, "%c", in->data.char_val);
         break;
     case STRING_VAL:
-        free(out->data.str_val);
-        out->data.str_val = strdup(in->data.str_val);
-        break;
+        string_copy(&out->data.str_val, &in->data.str_val);
+        return out;
     case BOOL_VAL:
-        snprintf(out->data.str_val, 1024, "%s",
-                 in->data.bool_val ? "True" : "False");
+        length = snprintf(buf, STRING_BUF_SIZE, "%s",
+                          in->data.bool_val ? "True" : "False");
         break;
     case SEQ_VAL:
-        snprintf(out->data.str_val, 1024, "Sequence of length %d",
-                 in->data.seq_val->count);
+        length = snprintf(buf, STRING_BUF_SIZE, "Sequence of length %d",
+                          in->data.seq_val->count);
+        break;
+    case MAP_VAL:
+        length = snprintf(buf, STRING_BUF_SIZE, "Map of size %d",
+                          in->data.map_val->count);
+        break;
+    case ARRAY_VAL:
+        length = snprintf(buf, STRING_BUF_SIZE, "Array of shape");
+        for(i = 0; i < in->data.array_val->rank; i++)
+        {
+            length += snprintf(buf + length, STRING_BUF_SIZE - length,
+                               i ? "x%d" : " %d",
+                               in->data.array_val->shape[i]);
+            if(length >= STRING_BUF_SIZE)
+            {
+                length = STRING_BUF_SIZE - 1;
+                break;
+            }
+        }
         break;
     case BOTTOM_VAL:
-        snprintf(out->data.str_val, 1024, "%s", "Bottom");
+        length = snprintf(buf, STRING_BUF_SIZE, "%s", "Bottom");
         break;
+    case STREAM_VAL:
+    case THUNK_VAL:
+        // Primitives are given these already materialized and forced, so
+        // one turning up here is an error
+        out->type = BOTTOM_VAL;
+        return out;
     }
 
+    // Only the characters actually written are kept
+    string_init(&out->data.str_val, buf, length);
     return out;
 }
 
@@ -973,13 +965,15 @@ struct value *to_string(struct list *args, struct value *in)
  * Output - The same string that was passed in as input, or bottom if a
  * non-string is passed in.  In additition to passing its input through
  * unchanged, the print function prints its string input out to the screen.
+ * Output is buffered, see flush.
  */
 struct value *print_str(struct list *args, struct value *in)
 {
     if(in->type != STRING_VAL)
         return value_new();
 
-    printf("%s", in->data.str_val);
+    io_write(&IO_STDOUT, string_text(&in->data.str_val),
+             in->data.str_val.length);
 
     return value_copy(in);
 }
@@ -990,63 +984,204 @@ struct value *print_str(struct list *args, struct value *in)
  * Output - The same string that was passed in as input, or bottom if a
  * non-string is passed in.  In addition to passing its input through
  * unchanged, the println function prints its string input to the screen with an
- * additional newline at the end.
+ * additional newline at the end.  Output is buffered, see flush.
  */
 struct value *println_str(struct list *args, struct value *in)
 {
     if(in->type != STRING_VAL)
         return value_new();
 
-    printf("%s\n", in->data.str_val);
+    io_write_line(&IO_STDOUT, string_text(&in->data.str_val),
+                  in->data.str_val.length);
+
+    return value_copy(in);
+}
+
+/*** eprint
+ * Prints output to standard error.
+ * Input - A string value.
+ * Output - The same string that was passed in as input, or bottom if a
+ * non-string is passed in.  Works like print, except that the string goes
+ * to standard error, which has its own buffer.
+ */
+struct value *eprint_str(struct list *args, struct value *in)
+{
+    if(in->type != STRING_VAL)
+        return value_new();
+
+    io_write(&IO_STDERR, string_text(&in->data.str_val),
+             in->data.str_val.length);
 
     return value_copy(in);
 }
 
+/*** eprintln
+ * Prints output to a line on standard error.
+ * Input - A string value.
+ * Output - The same string that was passed in as input, or bottom if a
+ * non-string is passed in.  Works like println, except that the string goes
+ * to standard error, which has its own buffer.
+ */
+struct value *eprintln_str(struct list *args, struct value *in)
+{
+    if(in->type != STRING_VAL)
+        return value_new();
+
+    io_write_line(&IO_STDERR, string_text(&in->data.str_val),
+                  in->data.str_val.length);
+
+    return value_copy(in);
+}
+
+/*** flush
+ * Writes out buffered output.
+ * Input - Any value.
+ * Output - The same value that was passed in as input.  Anything printed
+ * that's still waiting in the output buffers of standard output and
+ * standard error is written out.  Buffers are also flushed when they fill,
+ * before readln reads, when the program exits, and, if the flush policy is
+ * line, after every line.
+ */
+struct value *flush(struct list *args, struct value *in)
+{
+    io_flush_all();
+    return value_copy(in);
+}
+
 /*** readln
  * Reads a line of input from the terminal.
  * Input - Any non-bottom value.
- * Output - A string containing a line read from the user.
+ * Output - A string containing a line read from the user, without its
+ * newline, or bottom at the end of input.  Buffered output is flushed
+ * first, so that any prompt is visible.
  */
 struct value *readln_str(struct list *args, struct value *in)
 {
-    int bufsize = 100;
-    int i = 0;
+    const char *line = NULL;
+    int length;
     struct value *out = value_new();
-    out->type = STRING_VAL;
-    out->data.str_val = malloc(sizeof(char) * bufsize);
 
-    for(i = 0; 1; i++)
+    io_flush_all();
+
+    pthread_mutex_lock(&IO_STDIN.lock);
+    line = io_read_line(&IO_STDIN, &length);
+    if(line)
     {
-        out->data.str_val[i] = fgetc(stdin);
+        out->type = STRING_VAL;
+        string_init(&out->data.str_val, line, length);
+    }
+    pthread_mutex_unlock(&IO_STDIN.lock);
 
-        if(out->data.str_val[i] == '\n')
-        {
-            out->data.str_val[i] = '\0';
-            return out;
-        }
+    return out;
+}
 
-        if(i == bufsize - 1)
-        {
-            bufsize *= 2;
-            out->data.str_val = realloc(out->data.str_val, bufsize);
-        }
+/*** readlines
+ * Reads all remaining lines of input.
+ * Input - Any non-bottom value.
+ * Output - A sequence of strings, one for each line left in the input,
+ * without their newlines.  The sequence is empty if there is no input
+ * left.  Buffered output is flushed first, as with readln.
+ */
+struct value *readlines_str(struct list *args, struct value *in)
+{
+    const char *line = NULL;
+    int length;
+    struct value *out = value_new();
+    struct value *element = NULL;
+
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+
+    io_flush_all();
+
+    pthread_mutex_lock(&IO_STDIN.lock);
+    while((line = io_read_line(&IO_STDIN, &length)))
+    {
+        element = value_new();
+        element->type = STRING_VAL;
+        string_init(&element->data.str_val, line, length);
+        list_push_back(out->data.seq_val, element);
+    }
+    pthread_mutex_unlock(&IO_STDIN.lock);
+
+    return out;
+}
+
+/*** lines
+ * Streams lines of text from a file or standard input.
+ * Input - A string naming a file, or any other non-bottom value to read
+ * standard input.
+ * Output - A stream of strings, one for each line, without their
+ * newlines.  Lines are read only as the stream is consumed, so input of
+ * any size can be processed in constant memory.  Bottom if the file can't
+ * be opened.
+ */
+struct value *lines(struct list *args, struct value *in)
+{
+    struct value *out = NULL;
+
+    io_flush_all();
+
+    if(in->type == STRING_VAL)
+        out = stream_lines(string_text(&in->data.str_val));
+    else
+        out = stream_lines(NULL);
+
+    return out ? out : value_new();
+}
+
+/*** range
+ * Streams a range of integers.
+ * Input - A sequence of two integers, unless the bounds are given as
+ * specializers, as in range(a, b), in which case the input is ignored.
+ * Output - A stream of the integers starting at the first bound, up to
+ * but not including the second.
+ */
+struct value *range(struct list *args, struct value *in)
+{
+    struct value *start = NULL;
+    struct value *end = NULL;
+
+    if(args && args->count == 2)
+    {
+        start = list_get(args, 0);
+        end = list_get(args, 1);
     }
+    else if(in->type == SEQ_VAL && in->data.seq_val->count == 2)
+    {
+        start = list_get(in->data.seq_val, 0);
+        end = list_get(in->data.seq_val, 1);
+    }
+
+    if(!start || start->type != INT_VAL || end->type != INT_VAL)
+        return value_new();
+
+    return stream_range(start->data.int_val, end->data.int_val);
 }
 
 /*** head
  * Returns the first element of a sequence.
  * Input - A sequence.
  * Output - The first item in that sequence, or <> if the sequence is empty.
+ * Only the first element of a stream is pulled, so the head of a stream
+ * is bottom only if its first element is.
  */
 struct value *head(struct list *args, struct value *in)
 {
     struct value *out = NULL;
 
-    if(in->type != SEQ_VAL)
+    if(in->type == STREAM_VAL)
+        out = stream_next(in->data.stream_val);
+
+    if(out)
+    {
+        return out;
+    }
+    else if(in->type != SEQ_VAL && in->type != STREAM_VAL)
     {
         return value_new();
     }
-    else if(in->data.seq_val->count > 0)
+    else if(in->type == SEQ_VAL && in->data.seq_val->count > 0)
     {
         return value_copy(list_get(in->data.seq_val, 0));
     }
@@ -1063,14 +1198,30 @@ struct value *head(struct list *args, struct value *in)
  * Returns the portion of a sequence after the head.
  * Input - A sequence
  * Output - A sequence containing every element in the input sequence except
- * for the first, or <> if the sequence is empty.
+ * for the first, or <> if the sequence is empty.  The tail of a stream is
+ * another stream, or bottom if the head it drops is bottom.
  */
 struct value *tail(struct list *args, struct value *in)
 {
-    struct value *out = value_new();
+    struct value *out = NULL;
     struct list *l = NULL;
     struct cursor *c = NULL;
 
+    // Dropping the head of a stream leaves the rest of it
+    if(in->type == STREAM_VAL)
+    {
+        out = stream_next(in->data.stream_val);
+        if(!out)
+            return value_copy(in);
+
+        if(value_is_bottom(out))
+            return out;
+
+        value_delete(out);
+        return value_copy(in);
+    }
+
+    out = value_new();
     if(in->type != SEQ_VAL)
     {
         return out;
@@ -1095,11 +1246,31 @@ struct value *tail(struct list *args, struct value *in)
 /*** length
  * Returns the length of a sequence or string.
  * Input - A sequence or string.
- * Output - The length of the input as an integer.
+ * Output - The length of the input as an integer.  A stream is counted by
+ * pulling every element from it, and is bottom if any of them are.
  */
 struct value *length(struct list *args, struct value *in)
 {
     struct value *out = value_new();
+    struct value *element = NULL;
+
+    if(in->type == STREAM_VAL)
+    {
+        out->type = INT_VAL;
+        out->data.int_val = 0;
+        while((element = stream_next(in->data.stream_val)))
+        {
+            if(value_is_bottom(element))
+            {
+                value_delete(element);
+                out->type = BOTTOM_VAL;
+                return out;
+            }
+            value_delete(element);
+            out->data.int_val++;
+        }
+        return out;
+    }
 
     if(in->type != SEQ_VAL && in->type != STRING_VAL)
         return out;
@@ -1108,7 +1279,7 @@ struct value *length(struct list *args, struct value *in)
     if(in->type == SEQ_VAL)
         out->data.int_val = in->data.seq_val->count;
     else
-        out->data.int_val = strlen(in->data.str_val);
+        out->data.int_val = in->data.str_val.length;
 
     return out;
 }
@@ -1128,6 +1299,7 @@ struct value *append(struct list *args, struct value *in)
        || ((struct value*)list_get(in->data.seq_val, 1))->type != SEQ_VAL)
         return out;
 
+    value_delete(out);
     l = in->data.seq_val;
     out = value_copy(list_get(l, 1));
     list_push_back(out->data.seq_val, value_copy(list_get(l, 0)));
@@ -1150,6 +1322,7 @@ struct value *prepend(struct list *args, struct value *in)
        || ((struct value*)list_get(in->data.seq_val, 1))->type != SEQ_VAL)
         return out;
 
+    value_delete(out);
     l = in->data.seq_val;
     out = value_copy(list_get(l, 1));
     list_push(out->data.seq_val, value_copy(list_get(l, 0)));
@@ -1157,3 +1330,848 @@ struct value *prepend(struct list *args, struct value *in)
     return out;
 }
 
+// Builds a pair from copies of two values, for distl and distr
+struct value *_dist_pair(struct value *a, struct value *b)
+{
+    struct value *pair = value_new();
+
+    pair->type = SEQ_VAL;
+    pair->data.seq_val = list_new();
+    list_push_back(pair->data.seq_val, value_copy(a));
+    list_push_back(pair->data.seq_val, value_copy(b));
+    return pair;
+}
+
+/*** distl
+ * Distributes a value from the left over a sequence.
+ * Input - A sequence of length 2.  The second element must be a list.
+ * Output - A sequence pairing the first element of the input with each
+ * element of the second, in order.
+ */
+struct value *distl(struct list *args, struct value *in)
+{
+    struct value *out = value_new();
+    struct value *x = NULL;
+    struct value *l = NULL;
+    struct list_node *node = NULL;
+
+    if(in->type != SEQ_VAL || in->data.seq_val->count != 2)
+        return out;
+
+    x = in->data.seq_val->front->data;
+    l = in->data.seq_val->back->data;
+    if(l->type != SEQ_VAL)
+        return out;
+
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    for(node = l->data.seq_val->front; node; node = node->next)
+        list_push_back(out->data.seq_val, _dist_pair(x, node->data));
+
+    return out;
+}
+
+/*** distr
+ * Distributes a value from the right over a sequence.
+ * Input - A sequence of length 2.  The first element must be a list.
+ * Output - A sequence pairing each element of the first element of the
+ * input with the second, in order.
+ */
+struct value *distr(struct list *args, struct value *in)
+{
+    struct value *out = value_new();
+    struct value *l = NULL;
+    struct value *x = NULL;
+    struct list_node *node = NULL;
+
+    if(in->type != SEQ_VAL || in->data.seq_val->count != 2)
+        return out;
+
+    l = in->data.seq_val->front->data;
+    x = in->data.seq_val->back->data;
+    if(l->type != SEQ_VAL)
+        return out;
+
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    for(node = l->data.seq_val->front; node; node = node->next)
+        list_push_back(out->data.seq_val, _dist_pair(node->data, x));
+
+    return out;
+}
+
+/*** trans
+ * Transposes a sequence of rows into a sequence of columns.
+ * Input - A sequence of sequences, all of the same length.
+ * Output - A sequence whose nth element holds the nth element of each
+ * input sequence, in order.  The transpose of an empty sequence is empty.
+ */
+struct value *trans(struct list *args, struct value *in)
+{
+    struct value *out = value_new();
+    struct value *row = NULL;
+    struct value *column = NULL;
+    struct list_node *node = NULL;
+    struct list_node **cursors = NULL;
+    int rows, columns;
+    int i, j;
+
+    if(in->type != SEQ_VAL)
+        return out;
+
+    // Every row has to be a sequence of the same length
+    rows = in->data.seq_val->count;
+    columns = 0;
+    for(node = in->data.seq_val->front, i = 0; node; node = node->next, i++)
+    {
+        row = node->data;
+        if(row->type != SEQ_VAL)
+            return out;
+        if(!i)
+            columns = row->data.seq_val->count;
+        else if(row->data.seq_val->count != columns)
+            return out;
+    }
+
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    if(!rows)
+        return out;
+
+    // Walking every row in step, one node pointer per row, so each column
+    // is gathered in a single sweep instead of indexing into each row
+    cursors = (struct list_node**)malloc(rows * sizeof(struct list_node*));
+    for(node = in->data.seq_val->front, i = 0; node; node = node->next, i++)
+        cursors[i] = ((struct value*)node->data)->data.seq_val->front;
+
+    for(j = 0; j < columns; j++)
+    {
+        column = value_new();
+        column->type = SEQ_VAL;
+        column->data.seq_val = list_new();
+        for(i = 0; i < rows; i++)
+        {
+            list_push_back(column->data.seq_val, value_copy(cursors[i]->data));
+            cursors[i] = cursors[i]->next;
+        }
+        list_push_back(out->data.seq_val, column);
+    }
+
+    free(cursors);
+    return out;
+}
+
+// Gets the array standing for one of an array primitive's operands, a
+// number being an array with no dimensions, returns NULL for anything else
+struct array *_array_operand(struct value *value)
+{
+    struct array *array = NULL;
+
+    if(value->type == ARRAY_VAL)
+    {
+        value->data.array_val->refs++;
+        return value->data.array_val;
+    }
+
+    if(value->type == INT_VAL)
+    {
+        array = array_new(0, 0, NULL);
+        array->data.ints[0] = value->data.int_val;
+    }
+    else if(value->type == FLOAT_VAL)
+    {
+        array = array_new(1, 0, NULL);
+        array->data.floats[0] = value->data.float_val;
+    }
+
+    return array;
+}
+
+// Wraps the result of an array operation in a value, a number if it has
+// no dimensions or bottom if it's NULL
+struct value *_array_result(struct array *array)
+{
+    struct value *out = NULL;
+
+    if(!array)
+        return value_new();
+
+    if(array->rank)
+        return array_value(array);
+
+    out = array_unpack(array);
+    array_release(array);
+    return out;
+}
+
+// Applies an elementwise operator to a pair of arrays or numbers
+struct value *_array_apply(enum array_op op, struct value *in)
+{
+    struct array *a = NULL;
+    struct array *b = NULL;
+    struct array *out = NULL;
+
+    if(in->type != SEQ_VAL || in->data.seq_val->count != 2)
+        return value_new();
+
+    a = _array_operand(in->data.seq_val->front->data);
+    b = _array_operand(in->data.seq_val->back->data);
+    if(a && b)
+        out = array_apply(op, a, b);
+
+    if(a)
+        array_release(a);
+    if(b)
+        array_release(b);
+    return _array_result(out);
+}
+
+/*** array
+ * Packs numbers into an array.
+ * Input - A sequence of integers or floating point numbers, or a sequence
+ * of such sequences all of the same length, and so on to any depth.
+ * Output - An array of the same shape holding the same numbers, floating
+ * point if any of them are.  Arrays are turned back into sequences when
+ * they're returned from main.
+ */
+struct value *pack_array(struct list *args, struct value *in)
+{
+    if(in->type != SEQ_VAL)
+        return value_new();
+
+    return _array_result(array_pack(in));
+}
+
+/*** unarray
+ * Unpacks an array into sequences.
+ * Input - An array.
+ * Output - Nested sequences of the array's shape holding its numbers.
+ */
+struct value *unpack_array(struct list *args, struct value *in)
+{
+    if(in->type != ARRAY_VAL)
+        return value_new();
+
+    return array_unpack(in->data.array_val);
+}
+
+/*** shape
+ * Gives the shape of an array.
+ * Input - An array.
+ * Output - A sequence of the array's length along each of its dimensions.
+ */
+struct value *shape(struct list *args, struct value *in)
+{
+    struct value *out = value_new();
+    struct value *length = NULL;
+    int i;
+
+    if(in->type != ARRAY_VAL)
+        return out;
+
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    for(i = 0; i < in->data.array_val->rank; i++)
+    {
+        length = value_new();
+        length->type = INT_VAL;
+        length->data.int_val = in->data.array_val->shape[i];
+        list_push_back(out->data.seq_val, length);
+    }
+
+    return out;
+}
+
+/*** matmul
+ * Matrix multiplication.
+ * Input - A sequence of two arrays of two dimensions each, where the rows
+ * of the first are as long as the columns of the second.
+ * Output - Their product, an array with as many rows as the first and as
+ * many columns as the second.
+ */
+struct value *matmul(struct list *args, struct value *in)
+{
+    struct value *a = NULL;
+    struct value *b = NULL;
+
+    if(in->type != SEQ_VAL || in->data.seq_val->count != 2)
+        return value_new();
+
+    a = in->data.seq_val->front->data;
+    b = in->data.seq_val->back->data;
+    if(a->type != ARRAY_VAL || b->type != ARRAY_VAL)
+        return value_new();
+
+    return _array_result(array_multiply(a->data.array_val,
+                                        b->data.array_val));
+}
+
+/*** a+
+ * Elementwise array addition.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - An array of the sums of their corresponding elements, floating
+ * point if either of them is.  A number is added to every element.
+ */
+struct value *array_plus(struct list *args, struct value *in)
+{
+    return _array_apply(ARRAY_ADD, in);
+}
+
+/*** a-
+ * Elementwise array subtraction.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - An array of the differences of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *array_minus(struct list *args, struct value *in)
+{
+    return _array_apply(ARRAY_SUBTRACT, in);
+}
+
+/*** a*
+ * Elementwise array multiplication.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - An array of the products of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *array_times(struct list *args, struct value *in)
+{
+    return _array_apply(ARRAY_MULTIPLY, in);
+}
+
+/*** a/
+ * Elementwise array division.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - A floating point array of the quotients of their corresponding
+ * elements.
+ */
+struct value *array_over(struct list *args, struct value *in)
+{
+    return _array_apply(ARRAY_DIVIDE, in);
+}
+
+/*** asum
+ * Sums an array.  Accepts the axis to sum along as a specializer, as in
+ * asum(0) to add up the rows of a matrix.
+ * Input - An array.
+ * Output - Without a specializer, the sum of all its elements.  With one,
+ * an array with that axis summed away, or a number if that leaves none.
+ */
+struct value *axis_sum(struct list *args, struct value *in)
+{
+    struct value *axis = NULL;
+
+    if(in->type != ARRAY_VAL)
+        return value_new();
+
+    if(!args || !args->count)
+        return _array_result(array_sum(in->data.array_val, -1));
+
+    axis = list_get(args, 0);
+    if(args->count != 1 || axis->type != INT_VAL || axis->data.int_val < 0)
+        return value_new();
+
+    return _array_result(array_sum(in->data.array_val, axis->data.int_val));
+}
+
+// Gets the array standing for one of a vector primitive's operands,
+// packing sequences, and setting arrays if it was an array already
+struct array *_vector_operand(struct value *value, int *arrays)
+{
+    if(value->type == ARRAY_VAL)
+        *arrays = 1;
+
+    if(value->type != SEQ_VAL)
+        return _array_operand(value);
+
+    return array_pack(value);
+}
+
+// Wraps the result of a vector operation in a value, unpacking it back
+// into sequences unless any of its operands were arrays
+struct value *_vector_result(struct array *array, int arrays)
+{
+    struct value *out = NULL;
+
+    if(!array || !array->rank || arrays)
+        return _array_result(array);
+
+    out = array_unpack(array);
+    array_release(array);
+    return out;
+}
+
+// Applies an elementwise operator to a pair of sequences, arrays or
+// numbers
+struct value *_vector_apply(enum array_op op, struct value *in)
+{
+    struct array *a = NULL;
+    struct array *b = NULL;
+    struct array *out = NULL;
+    int arrays = 0;
+
+    if(in->type != SEQ_VAL || in->data.seq_val->count != 2)
+        return value_new();
+
+    a = _vector_operand(in->data.seq_val->front->data, &arrays);
+    b = _vector_operand(in->data.seq_val->back->data, &arrays);
+    if(a && b)
+        out = array_apply(op, a, b);
+
+    if(a)
+        array_release(a);
+    if(b)
+        array_release(b);
+    return _vector_result(out, arrays);
+}
+
+// Applies an elementwise function to a sequence or array
+struct value *_vector_map(enum array_fn fn, struct value *in)
+{
+    struct array *array = NULL;
+    struct array *out = NULL;
+    int arrays = 0;
+
+    if(in->type != SEQ_VAL && in->type != ARRAY_VAL)
+        return value_new();
+
+    array = _vector_operand(in, &arrays);
+    if(!array)
+        return value_new();
+
+    out = array_map(fn, array);
+    array_release(array);
+    return _vector_result(out, arrays);
+}
+
+/*** v+
+ * Elementwise addition.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.  Nested sequences of the same shape
+ * and arrays work as well.
+ * Output - A sequence of the sums of their corresponding elements,
+ * floating point if either of them is.  A number is added to every
+ * element.  The result is an array if either input is.
+ */
+struct value *vector_plus(struct list *args, struct value *in)
+{
+    return _vector_apply(ARRAY_ADD, in);
+}
+
+/*** v-
+ * Elementwise subtraction.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the differences of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *vector_minus(struct list *args, struct value *in)
+{
+    return _vector_apply(ARRAY_SUBTRACT, in);
+}
+
+/*** v*
+ * Elementwise multiplication.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the products of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *vector_times(struct list *args, struct value *in)
+{
+    return _vector_apply(ARRAY_MULTIPLY, in);
+}
+
+/*** v/
+ * Elementwise division.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A floating point sequence of the quotients of their
+ * corresponding elements.
+ */
+struct value *vector_over(struct list *args, struct value *in)
+{
+    return _vector_apply(ARRAY_DIVIDE, in);
+}
+
+/*** vmin
+ * Elementwise minimum.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the lesser of each pair of corresponding
+ * elements, floating point if either input is.
+ */
+struct value *vector_min(struct list *args, struct value *in)
+{
+    return _vector_apply(ARRAY_MIN, in);
+}
+
+/*** vmax
+ * Elementwise maximum.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the greater of each pair of corresponding
+ * elements, floating point if either input is.
+ */
+struct value *vector_max(struct list *args, struct value *in)
+{
+    return _vector_apply(ARRAY_MAX, in);
+}
+
+/*** vabs
+ * Elementwise absolute value.
+ * Input - A sequence of numbers, nested sequences of them or an array.
+ * Output - The absolute values of its elements in the same shape.
+ */
+struct value *vector_abs(struct list *args, struct value *in)
+{
+    return _vector_map(ARRAY_ABS, in);
+}
+
+/*** vsqrt
+ * Elementwise square root.
+ * Input - A sequence of numbers, nested sequences of them or an array.
+ * Output - The floating point square roots of its elements in the same
+ * shape, not a number for any negative ones.
+ */
+struct value *vector_sqrt(struct list *args, struct value *in)
+{
+    return _vector_map(ARRAY_SQRT, in);
+}
+
+// Lists the elements of a sequence as items to be sorted, numbered by
+// position
+struct sort_item *_sort_items(struct list *list)
+{
+    struct sort_item *items = NULL;
+    struct list_node *node = NULL;
+    int i = 0;
+
+    items = (struct sort_item*)malloc((list->count + 1)
+                                      * sizeof(struct sort_item));
+    for(node = list->front; node; node = node->next, i++)
+    {
+        items[i].value = node->data;
+        items[i].index = i;
+    }
+
+    return items;
+}
+
+// Sorts a one dimensional array into a new array
+struct value *_sort_array(struct array *array)
+{
+    struct array *out = NULL;
+    struct sort_item *items = NULL;
+    int i;
+
+    if(array->rank != 1)
+        return value_new();
+
+    out = array_new(array->is_float, 1, array->shape);
+    if(!array->is_float)
+    {
+        memcpy(out->data.ints, array->data.ints, array->count * sizeof(int));
+        sort_ints(out->data.ints, NULL, out->count);
+        return array_value(out);
+    }
+
+    items = (struct sort_item*)malloc((array->count + 1)
+                                      * sizeof(struct sort_item));
+    for(i = 0; i < array->count; i++)
+        items[i].number = array->data.floats[i];
+
+    sort_quick(items, array->count, SORT_BY_NUMBER);
+    for(i = 0; i < array->count; i++)
+        out->data.floats[i] = items[i].number;
+
+    free(items);
+    return array_value(out);
+}
+
+/*** sort
+ * Sorts a sequence.  Ints and characters are radix sorted, floats and
+ * strings quicksorted, and sequences mixing ints with floats merge sorted.
+ * Input - A sequence of numbers, of characters, or of strings, or a one
+ * dimensional array.
+ * Output - The same elements in ascending order, as lt orders them, or an
+ * array with its elements in ascending order.
+ */
+struct value *sort(struct list *args, struct value *in)
+{
+    struct value *out = NULL;
+    struct value *e = NULL;
+    struct list_node *node = NULL;
+    struct sort_item *items = NULL;
+    enum sort_kind kind = SORT_EMPTY;
+    int *keys = NULL;
+    int count;
+    int i;
+
+    if(in->type == ARRAY_VAL)
+        return _sort_array(in->data.array_val);
+
+    out = value_new();
+    if(in->type != SEQ_VAL)
+        return out;
+
+    for(node = in->data.seq_val->front; node && kind != SORT_UNORDERED;
+        node = node->next)
+    {
+        kind = sort_classify(kind, node->data);
+    }
+
+    if(kind == SORT_UNORDERED)
+        return out;
+
+    count = in->data.seq_val->count;
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+
+    if(kind == SORT_INTS || kind == SORT_CHARS)
+    {
+        // Equal ints are indistinguishable, so the sorted keys are all
+        // that's needed to make the output
+        keys = (int*)malloc((count + 1) * sizeof(int));
+        for(node = in->data.seq_val->front, i = 0; node;
+            node = node->next, i++)
+        {
+            e = node->data;
+            keys[i] = kind == SORT_INTS ? e->data.int_val : e->data.char_val;
+        }
+
+        sort_ints(keys, NULL, count);
+        for(i = 0; i < count; i++)
+        {
+            e = value_new();
+            if(kind == SORT_INTS)
+            {
+                e->type = INT_VAL;
+                e->data.int_val = keys[i];
+            }
+            else
+            {
+                e->type = CHAR_VAL;
+                e->data.char_val = keys[i];
+            }
+            list_push_back(out->data.seq_val, e);
+        }
+
+        free(keys);
+        return out;
+    }
+
+    items = _sort_items(in->data.seq_val);
+    if(kind == SORT_FLOATS)
+    {
+        // Like ints, the sorted numbers are enough to make the output
+        for(i = 0; i < count; i++)
+            items[i].number = items[i].value->data.float_val;
+        sort_quick(items, count, SORT_BY_NUMBER);
+
+        for(i = 0; i < count; i++)
+        {
+            e = value_new();
+            e->type = FLOAT_VAL;
+            e->data.float_val = items[i].number;
+            list_push_back(out->data.seq_val, e);
+        }
+
+        free(items);
+        return out;
+    }
+    else if(kind == SORT_STRINGS)
+    {
+        sort_quick(items, count, SORT_BY_STRING);
+    }
+    else
+    {
+        sort_merge(items, count, sort_order);
+    }
+
+    for(i = 0; i < count; i++)
+        list_push_back(out->data.seq_val, value_copy(items[i].value));
+
+    free(items);
+    return out;
+}
+
+/*** topk
+ * Finds the greatest elements of a sequence, keeping only as many at a
+ * time as it needs.  Accepts the number of elements to keep as a
+ * specializer, as in topk(10).
+ * Input - A sequence of numbers, of characters, or of strings.
+ * Output - The greatest elements, as lt orders them, in descending order.
+ * All of them if there are fewer than asked for.
+ */
+struct value *topk(struct list *args, struct value *in)
+{
+    struct value *out = value_new();
+    struct value *k = NULL;
+    struct list_node *node = NULL;
+    struct sort_item *heap = NULL;
+    enum sort_kind kind = SORT_EMPTY;
+    int size = 0;
+    int i;
+
+    if(!args || args->count != 1 || in->type != SEQ_VAL)
+        return out;
+
+    k = list_get(args, 0);
+    if(k->type != INT_VAL || k->data.int_val < 0)
+        return out;
+
+    for(node = in->data.seq_val->front; node && kind != SORT_UNORDERED;
+        node = node->next)
+    {
+        kind = sort_classify(kind, node->data);
+    }
+
+    if(kind == SORT_UNORDERED)
+        return out;
+
+    i = k->data.int_val < in->data.seq_val->count ? k->data.int_val
+        : in->data.seq_val->count;
+    heap = (struct sort_item*)malloc((i + 1) * sizeof(struct sort_item));
+    for(node = in->data.seq_val->front; node; node = node->next)
+        size = sort_top_offer(heap, size, i, node->data, sort_order);
+    sort_top_order(heap, size, sort_order);
+
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    for(i = 0; i < size; i++)
+        list_push_back(out->data.seq_val, value_copy(heap[i].value));
+
+    free(heap);
+    return out;
+}
+
+/*** mapnew
+ * Creates an empty map.
+ * Input - Anything, which is ignored.
+ * Output - A map with no keys.
+ */
+struct value *new_map(struct list *args, struct value *in)
+{
+    return hashmap_value(hashmap_new());
+}
+
+/*** mapget
+ * Looks up a key in a map.
+ * Input - A sequence of a map and a key, optionally followed by a default
+ * value.
+ * Output - The key's value, or the default if the map doesn't have the key,
+ * or bottom if there's no default.
+ */
+struct value *map_get(struct list *args, struct value *in)
+{
+    struct value *map = NULL;
+    struct value *out = NULL;
+
+    if(in->type != SEQ_VAL || in->data.seq_val->count < 2
+       || in->data.seq_val->count > 3)
+    {
+        return value_new();
+    }
+
+    map = in->data.seq_val->front->data;
+    if(map->type != MAP_VAL)
+        return value_new();
+
+    out = hashmap_get(map->data.map_val, in->data.seq_val->front->next->data);
+    if(!out && in->data.seq_val->count == 3)
+        out = in->data.seq_val->back->data;
+
+    return out ? value_copy(out) : value_new();
+}
+
+/*** mapput
+ * Sets a key's value in a map.
+ * Input - A sequence of a map, a key and a value.
+ * Output - A map with the key set to the value, which keeps its place if
+ * the key was already there and goes after every other key if it wasn't.
+ * The map given is only changed in place if nothing else holds it.
+ */
+struct value *map_put(struct list *args, struct value *in)
+{
+    struct value *map = NULL;
+    struct hashmap *out = NULL;
+
+    if(in->type != SEQ_VAL || in->data.seq_val->count != 3)
+        return value_new();
+
+    map = in->data.seq_val->front->data;
+    if(map->type != MAP_VAL)
+        return value_new();
+
+    // A map held only by the input is about to be freed along with it, so
+    // it can be changed in place instead of copied
+    out = map->data.map_val;
+    if(out->refs > 1)
+        out = hashmap_copy(out);
+    else
+        out->refs++;
+
+    hashmap_put(out, value_copy(in->data.seq_val->front->next->data),
+                value_copy(in->data.seq_val->back->data));
+    return hashmap_value(out);
+}
+
+/*** mapkeys
+ * Lists the keys of a map.
+ * Input - A map.
+ * Output - A sequence of its keys, in the order they were first added.
+ */
+struct value *map_keys(struct list *args, struct value *in)
+{
+    struct value *out = value_new();
+    struct hashmap *map = NULL;
+    int i;
+
+    if(in->type != MAP_VAL)
+        return out;
+
+    map = in->data.map_val;
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    for(i = 0; i < map->count; i++)
+        list_push_back(out->data.seq_val, value_copy(map->entries[i].key));
+
+    return out;
+}
+
+/*** mapfromseq
+ * Makes a map from a sequence of pairs.
+ * Input - A sequence of pairs of a key and a value.
+ * Output - A map with each key set to its value.  A key that appears more
+ * than once keeps its first place and its last value.
+ */
+struct value *map_from_seq(struct list *args, struct value *in)
+{
+    struct hashmap *map = NULL;
+    struct list_node *node = NULL;
+    struct value *pair = NULL;
+
+    if(in->type != SEQ_VAL)
+        return value_new();
+
+    map = hashmap_new();
+    for(node = in->data.seq_val->front; node; node = node->next)
+    {
+        pair = node->data;
+        if(pair->type != SEQ_VAL || pair->data.seq_val->count != 2)
+        {
+            hashmap_release(map);
+            return value_new();
+        }
+
+        hashmap_put(map, value_copy(pair->data.seq_val->front->data),
+                    value_copy(pair->data.seq_val->back->data));
+    }
+
+    return hashmap_value(map);
+}
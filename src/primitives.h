@@ -155,7 +155,7 @@ struct value *gte(struct list *args, struct value *in);
  * truncated, integers are passed through verbatim.  True becomes 1, False 
  * becomes 0.  Chars are converted to their ASCII values.  Strings are 
  * converted with the C atoi function.  Sequences simply return the sequence 
- * length.
+ * length.  Arrays and maps give bottom.
  */
 struct value *to_int(struct list *args, struct value *in);
 
@@ -167,14 +167,17 @@ struct value *to_int(struct list *args, struct value *in);
  * passed through verbatim.  True becomes 1.0, False becomes 0.0.  Chars are 
  * converted to their ASCII values and then cast to floating point.  Strings 
  * are converted with the C atof funciton.  Sequences simply return the 
- * sequence length.
+ * sequence length.  Arrays and maps give bottom.
  */
 struct value *to_float(struct list *args, struct value *in);
 
 /*** str
  * String conversion function.
  * Input - Any value other than bottom.
- * Output - A conversion of the input value to a string.
+ * Output - A conversion of the input value to a string.  Floating point
+ * numbers are written with the fewest digits that read back as the same
+ * number, and always with a decimal point, as in 2.0 or 0.1.  Numbers of
+ * 1e21 and up are written in scientific notation, as in 1.5e21.
  */
 struct value *to_string(struct list *args, struct value *in);
 
@@ -184,6 +187,7 @@ struct value *to_string(struct list *args, struct value *in);
  * Output - The same string that was passed in as input, or bottom if a 
  * non-string is passed in.  In additition to passing its input through 
  * unchanged, the print function prints its string input out to the screen.
+ * Output is buffered, see flush.
  */
 struct value *print_str(struct list *args, struct value *in);
 
@@ -193,21 +197,83 @@ struct value *print_str(struct list *args, struct value *in);
  * Output - The same string that was passed in as input, or bottom if a 
  * non-string is passed in.  In addition to passing its input through 
  * unchanged, the println function prints its string input to the screen with an
- * additional newline at the end.
+ * additional newline at the end.  Output is buffered, see flush.
  */
 struct value *println_str(struct list *args, struct value *in);
 
+/*** eprint
+ * Prints output to standard error.
+ * Input - A string value.
+ * Output - The same string that was passed in as input, or bottom if a
+ * non-string is passed in.  Works like print, except that the string goes
+ * to standard error, which has its own buffer.
+ */
+struct value *eprint_str(struct list *args, struct value *in);
+
+/*** eprintln
+ * Prints output to a line on standard error.
+ * Input - A string value.
+ * Output - The same string that was passed in as input, or bottom if a
+ * non-string is passed in.  Works like println, except that the string goes
+ * to standard error, which has its own buffer.
+ */
+struct value *eprintln_str(struct list *args, struct value *in);
+
+/*** flush
+ * Writes out buffered output.
+ * Input - Any value.
+ * Output - The same value that was passed in as input.  Anything printed
+ * that's still waiting in the output buffers of standard output and
+ * standard error is written out.  Buffers are also flushed when they fill,
+ * before readln reads, when the program exits, and, if the flush policy is
+ * line, after every line.
+ */
+struct value *flush(struct list *args, struct value *in);
+
 /*** readln
  * Reads a line of input from the terminal.
  * Input - Any non-bottom value.
- * Output - A string containing a line read from the user.
+ * Output - A string containing a line read from the user, without its
+ * newline, or bottom at the end of input.  Buffered output is flushed
+ * first, so that any prompt is visible.
  */
 struct value *readln_str(struct list *args, struct value *in);
 
+/*** readlines
+ * Reads all remaining lines of input.
+ * Input - Any non-bottom value.
+ * Output - A sequence of strings, one for each line left in the input,
+ * without their newlines.  The sequence is empty if there is no input
+ * left.  Buffered output is flushed first, as with readln.
+ */
+struct value *readlines_str(struct list *args, struct value *in);
+
+/*** lines
+ * Streams lines of text from a file or standard input.
+ * Input - A string naming a file, or any other non-bottom value to read
+ * standard input.
+ * Output - A stream of strings, one for each line, without their
+ * newlines.  Lines are read only as the stream is consumed, so input of
+ * any size can be processed in constant memory.  Bottom if the file can't
+ * be opened.
+ */
+struct value *lines(struct list *args, struct value *in);
+
+/*** range
+ * Streams a range of integers.
+ * Input - A sequence of two integers, unless the bounds are given as
+ * specializers, as in range(a, b), in which case the input is ignored.
+ * Output - A stream of the integers starting at the first bound, up to
+ * but not including the second.
+ */
+struct value *range(struct list *args, struct value *in);
+
 /*** head
  * Returns the first element of a sequence.
  * Input - A sequence.
  * Output - The first item in that sequence, or <> if the sequence is empty.
+ * Only the first element of a stream is pulled, so the head of a stream
+ * is bottom only if its first element is.
  */
 struct value *head(struct list *args, struct value *in);
 
@@ -215,14 +281,17 @@ struct value *head(struct list *args, struct value *in);
  * Returns the portion of a sequence after the head.
  * Input - A sequence
  * Output - A sequence containing every element in the input sequence except
- * for the first, or <> if the sequence is empty.
+ * for the first, or <> if the sequence is empty.  The tail of a stream is
+ * another stream, or bottom if the head it drops is bottom.
  */
 struct value *tail(struct list *args, struct value *in);
 
 /*** length
  * Returns the length of a sequence.
  * Input - A sequence.
- * Output - The length of the sequence as an integer.
+ * Output - The length of the sequence as an integer.  A stream is
+ * counted by pulling every element from it, and is bottom if any of them
+ * are.
  */
 struct value *length(struct list *args, struct value *in);
 
@@ -241,4 +310,237 @@ struct value *append(struct list *args, struct value *in);
  */
 struct value *prepend(struct list *args, struct value *in);
 
+/*** distl
+ * Distributes a value from the left over a sequence.
+ * Input - A sequence of length 2.  The second element must be a list.
+ * Output - A sequence pairing the first element of the input with each
+ * element of the second, in order.
+ */
+struct value *distl(struct list *args, struct value *in);
+
+/*** distr
+ * Distributes a value from the right over a sequence.
+ * Input - A sequence of length 2.  The first element must be a list.
+ * Output - A sequence pairing each element of the first element of the
+ * input with the second, in order.
+ */
+struct value *distr(struct list *args, struct value *in);
+
+/*** trans
+ * Transposes a sequence of rows into a sequence of columns.
+ * Input - A sequence of sequences, all of the same length.
+ * Output - A sequence whose nth element holds the nth element of each
+ * input sequence, in order.  The transpose of an empty sequence is empty.
+ */
+struct value *trans(struct list *args, struct value *in);
+
+/*** array
+ * Packs numbers into an array.
+ * Input - A sequence of integers or floating point numbers, or a sequence
+ * of such sequences all of the same length, and so on to any depth.
+ * Output - An array of the same shape holding the same numbers, floating
+ * point if any of them are.  Arrays are turned back into sequences when
+ * they're returned from main.
+ */
+struct value *pack_array(struct list *args, struct value *in);
+
+/*** unarray
+ * Unpacks an array into sequences.
+ * Input - An array.
+ * Output - Nested sequences of the array's shape holding its numbers.
+ */
+struct value *unpack_array(struct list *args, struct value *in);
+
+/*** shape
+ * Gives the shape of an array.
+ * Input - An array.
+ * Output - A sequence of the array's length along each of its dimensions.
+ */
+struct value *shape(struct list *args, struct value *in);
+
+/*** matmul
+ * Matrix multiplication.
+ * Input - A sequence of two arrays of two dimensions each, where the rows
+ * of the first are as long as the columns of the second.
+ * Output - Their product, an array with as many rows as the first and as
+ * many columns as the second.
+ */
+struct value *matmul(struct list *args, struct value *in);
+
+/*** a+
+ * Elementwise array addition.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - An array of the sums of their corresponding elements, floating
+ * point if either of them is.  A number is added to every element.
+ */
+struct value *array_plus(struct list *args, struct value *in);
+
+/*** a-
+ * Elementwise array subtraction.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - An array of the differences of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *array_minus(struct list *args, struct value *in);
+
+/*** a*
+ * Elementwise array multiplication.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - An array of the products of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *array_times(struct list *args, struct value *in);
+
+/*** a/
+ * Elementwise array division.
+ * Input - A sequence of two arrays of the same shape, or an array and a
+ * number.
+ * Output - A floating point array of the quotients of their corresponding
+ * elements.
+ */
+struct value *array_over(struct list *args, struct value *in);
+
+/*** asum
+ * Sums an array.  Accepts the axis to sum along as a specializer, as in
+ * asum(0) to add up the rows of a matrix.
+ * Input - An array.
+ * Output - Without a specializer, the sum of all its elements.  With one,
+ * an array with that axis summed away, or a number if that leaves none.
+ */
+struct value *axis_sum(struct list *args, struct value *in);
+
+/*** v+
+ * Elementwise addition.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.  Nested sequences of the same shape
+ * and arrays work as well.
+ * Output - A sequence of the sums of their corresponding elements,
+ * floating point if either of them is.  A number is added to every
+ * element.  The result is an array if either input is.
+ */
+struct value *vector_plus(struct list *args, struct value *in);
+
+/*** v-
+ * Elementwise subtraction.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the differences of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *vector_minus(struct list *args, struct value *in);
+
+/*** v*
+ * Elementwise multiplication.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the products of their corresponding elements,
+ * floating point if either of them is.
+ */
+struct value *vector_times(struct list *args, struct value *in);
+
+/*** v/
+ * Elementwise division.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A floating point sequence of the quotients of their
+ * corresponding elements.
+ */
+struct value *vector_over(struct list *args, struct value *in);
+
+/*** vmin
+ * Elementwise minimum.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the lesser of each pair of corresponding
+ * elements, floating point if either input is.
+ */
+struct value *vector_min(struct list *args, struct value *in);
+
+/*** vmax
+ * Elementwise maximum.
+ * Input - A sequence of two sequences of numbers of the same length, or a
+ * sequence of numbers and a number.
+ * Output - A sequence of the greater of each pair of corresponding
+ * elements, floating point if either input is.
+ */
+struct value *vector_max(struct list *args, struct value *in);
+
+/*** vabs
+ * Elementwise absolute value.
+ * Input - A sequence of numbers, nested sequences of them or an array.
+ * Output - The absolute values of its elements in the same shape.
+ */
+struct value *vector_abs(struct list *args, struct value *in);
+
+/*** vsqrt
+ * Elementwise square root.
+ * Input - A sequence of numbers, nested sequences of them or an array.
+ * Output - The floating point square roots of its elements in the same
+ * shape, not a number for any negative ones.
+ */
+struct value *vector_sqrt(struct list *args, struct value *in);
+
+/*** sort
+ * Sorts a sequence.  Ints and characters are radix sorted, floats and
+ * strings quicksorted, and sequences mixing ints with floats merge sorted.
+ * Input - A sequence of numbers, of characters, or of strings, or a one
+ * dimensional array.
+ * Output - The same elements in ascending order, as lt orders them, or an
+ * array with its elements in ascending order.
+ */
+struct value *sort(struct list *args, struct value *in);
+
+/*** topk
+ * Finds the greatest elements of a sequence, keeping only as many at a
+ * time as it needs.  Accepts the number of elements to keep as a
+ * specializer, as in topk(10).
+ * Input - A sequence of numbers, of characters, or of strings.
+ * Output - The greatest elements, as lt orders them, in descending order.
+ * All of them if there are fewer than asked for.
+ */
+struct value *topk(struct list *args, struct value *in);
+
+/*** mapnew
+ * Creates an empty map.
+ * Input - Anything, which is ignored.
+ * Output - A map with no keys.
+ */
+struct value *new_map(struct list *args, struct value *in);
+
+/*** mapget
+ * Looks up a key in a map.
+ * Input - A sequence of a map and a key, optionally followed by a default
+ * value.
+ * Output - The key's value, or the default if the map doesn't have the key,
+ * or bottom if there's no default.
+ */
+struct value *map_get(struct list *args, struct value *in);
+
+/*** mapput
+ * Sets a key's value in a map.
+ * Input - A sequence of a map, a key and a value.
+ * Output - A map with the key set to the value, which keeps its place if
+ * the key was already there and goes after every other key if it wasn't.
+ * The map given is only changed in place if nothing else holds it.
+ */
+struct value *map_put(struct list *args, struct value *in);
+
+/*** mapkeys
+ * Lists the keys of a map.
+ * Input - A map.
+ * Output - A sequence of its keys, in the order they were first added.
+ */
+struct value *map_keys(struct list *args, struct value *in);
+
+/*** mapfromseq
+ * Makes a map from a sequence of pairs.
+ * Input - A sequence of pairs of a key and a value.
+ * Output - A map with each key set to its value.  A key that appears more
+ * than once keeps its first place and its last value.
+ */
+struct value *map_from_seq(struct list *args, struct value *in);
+
 #endif // PRIMITIVES_H
@@ -0,0 +1,362 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "interpreter.h"
+#include "symtable.h"
+#include "parser.h"
+#include "lexer.h"
+#include "buffer.h"
+
+#define SERVER_BACKLOG 128
+#define SERVER_READ_SIZE 4096
+#define SERVER_MAX_REQUEST (16 * 1024 * 1024)
+
+struct server
+{
+    int epoll;
+    int listener;
+    struct symtable *table;
+};
+
+// A client connection, only ever serviced by one worker at a time
+struct connection
+{
+    int fd;
+    struct buffer *in;
+    struct buffer *out;
+};
+
+// Runs on every worker thread, waiting for and servicing events
+void *server_worker(void *arg);
+// Accepts every pending connection on the listening socket
+void server_accept(struct server *server);
+// Reads and answers whatever requests a connection has sent
+void server_service(struct server *server, struct connection *conn);
+// Answers a single request line
+void server_handle(struct server *server, char *line, struct buffer *out);
+// Writes as much of a buffer as a non-blocking socket will take, keeping
+// the rest.  Returns 1 once it's all written, 0 if some is left over, or
+// -1 on error.
+int server_write(int fd, struct buffer *out);
+// Re-arms a connection to wait for more input, or for room to write if
+// it has output left over, closing it on error
+void server_arm(struct server *server, struct connection *conn);
+// Closes a connection and deletes it
+void server_close(struct server *server, struct connection *conn);
+
+// Serves calls to the functions in a symtable, returns only on error
+int server_run(struct symtable *table, const char *path, int threads)
+{
+    int i;
+    struct server server;
+    struct sockaddr_un address;
+    struct epoll_event event;
+    pthread_t thread;
+
+    if(strlen(path) >= sizeof(address.sun_path))
+    {
+        printf("Error: Socket path too long\n");
+        return 0;
+    }
+
+    if(threads < 1)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads < 1)
+        threads = 1;
+
+    // Setting up the listening socket
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);
+
+    server.table = table;
+    server.listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(server.listener < 0
+       || bind(server.listener, (struct sockaddr*)&address,
+               sizeof(address)) < 0
+       || listen(server.listener, SERVER_BACKLOG) < 0)
+    {
+        perror("Error: Couldn't listen on socket");
+        return 0;
+    }
+
+    // Every descriptor is registered one-shot, so only one worker ever
+    // handles a given connection at once.  The listener is marked with
+    // a NULL pointer.
+    server.epoll = epoll_create1(0);
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = NULL;
+    if(server.epoll < 0
+       || epoll_ctl(server.epoll, EPOLL_CTL_ADD, server.listener, &event) < 0)
+    {
+        perror("Error: Couldn't create event loop");
+        return 0;
+    }
+
+    // Starting the worker pool, this thread becomes the last worker
+    for(i = 1; i < threads; i++)
+    {
+        if(pthread_create(&thread, NULL, server_worker, &server))
+        {
+            printf("Error: Couldn't start worker thread\n");
+            return 0;
+        }
+        pthread_detach(thread);
+    }
+    server_worker(&server);
+
+    return 0;
+}
+
+// Runs on every worker thread, waiting for and servicing events
+void *server_worker(void *arg)
+{
+    struct server *server = (struct server*)arg;
+    struct epoll_event event;
+
+    while(1)
+    {
+        if(epoll_wait(server->epoll, &event, 1, -1) < 1)
+            continue;
+
+        if(event.data.ptr)
+            server_service(server, (struct connection*)event.data.ptr);
+        else
+            server_accept(server);
+    }
+
+    return NULL;
+}
+
+// Accepts every pending connection on the listening socket
+void server_accept(struct server *server)
+{
+    int fd;
+    struct connection *conn = NULL;
+    struct epoll_event event;
+
+    while((fd = accept4(server->listener, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+    {
+        conn = (struct connection*)malloc(sizeof(struct connection));
+        conn->fd = fd;
+        conn->in = buffer_new();
+        conn->out = buffer_new();
+
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = conn;
+        if(epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            buffer_delete(conn->in);
+            buffer_delete(conn->out);
+            free(conn);
+            close(fd);
+        }
+    }
+
+    // Re-arming the listener
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = NULL;
+    epoll_ctl(server->epoll, EPOLL_CTL_MOD, server->listener, &event);
+}
+
+// Reads and answers whatever requests a connection has sent
+void server_service(struct server *server, struct connection *conn)
+{
+    int closed = 0;
+    int n;
+    char buf[SERVER_READ_SIZE];
+    char *newline = NULL;
+
+    // Output left over from last time goes first, and nothing more is read
+    // until it's all gone, so a client that doesn't read its responses
+    // can't make them pile up
+    if(conn->out->length)
+    {
+        n = server_write(conn->fd, conn->out);
+        if(n < 0)
+        {
+            server_close(server, conn);
+            return;
+        }
+        if(!n)
+        {
+            server_arm(server, conn);
+            return;
+        }
+    }
+
+    // Reading until the socket runs dry, or there's more than a request
+    // can hold.  Anything past that is read on the next wakeup.
+    while(conn->in->length <= SERVER_MAX_REQUEST)
+    {
+        n = read(conn->fd, buf, SERVER_READ_SIZE);
+        if(n > 0)
+            buffer_append(conn->in, buf, n);
+        else if(n < 0 && errno == EINTR)
+            continue;
+        else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+        {
+            closed = 1;
+            break;
+        }
+    }
+
+    // Answering every complete line
+    while((newline = memchr(conn->in->data, '\n', conn->in->length)))
+    {
+        *newline = '\0';
+        server_handle(server, conn->in->data, conn->out);
+        buffer_consume(conn->in, newline - conn->in->data + 1);
+    }
+
+    if(conn->in->length > SERVER_MAX_REQUEST)
+    {
+        buffer_append_str(conn->out, "error Request too long\n");
+        closed = 1;
+    }
+
+    if(closed || server_write(conn->fd, conn->out) < 0)
+    {
+        server_close(server, conn);
+        return;
+    }
+
+    server_arm(server, conn);
+}
+
+// Answers a single request line
+void server_handle(struct server *server, char *line, struct buffer *out)
+{
+    char *name = line;
+    char *input = NULL;
+    struct function *function = NULL;
+    struct lexer_state *lexer = NULL;
+    struct value *in = NULL;
+    struct value *result = NULL;
+
+    // Splitting the function name from its input
+    while(*name == ' ' || *name == '\t' || *name == '\r')
+        name++;
+    for(input = name; *input && *input != ' ' && *input != '\t'; input++)
+        ;
+    if(*input)
+        *(input++) = '\0';
+
+    if(!*name)
+    {
+        buffer_append_str(out, "error Empty request\n");
+        return;
+    }
+
+    function = symtable_find(server->table, name);
+    if(!function)
+    {
+        buffer_append_str(out, "error No such function\n");
+        return;
+    }
+
+    // Reading the input value, which must be the only thing left
+    lexer = lexer_new();
+    lexer_init(lexer, input, strlen(input));
+    in = parse_constant(lexer, 0);
+    if(in)
+        lex(lexer);
+
+    if(!in || lexer->error != END_OF_INPUT)
+    {
+        if(in)
+            value_delete(in);
+        lexer_delete(lexer);
+        buffer_append_str(out, "error Invalid input value\n");
+        return;
+    }
+    lexer_delete(lexer);
+
+    result = value_resolve(function_exec(function, in));
+    value_serialize(result, out);
+    buffer_append_char(out, '\n');
+    value_delete(result);
+}
+
+// Writes as much of a buffer as a non-blocking socket will take, keeping
+// the rest.  Returns 1 once it's all written, 0 if some is left over, or
+// -1 on error.
+int server_write(int fd, struct buffer *out)
+{
+    int n;
+    int written = 0;
+
+    while(written < out->length)
+    {
+        n = send(fd, out->data + written, out->length - written,
+                 MSG_NOSIGNAL);
+        if(n >= 0)
+            written += n;
+        else if(errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        else if(errno != EINTR)
+            return -1;
+    }
+
+    buffer_consume(out, written);
+    return out->length ? 0 : 1;
+}
+
+// Re-arms a connection to wait for more input, or for room to write if
+// it has output left over, closing it on error
+void server_arm(struct server *server, struct connection *conn)
+{
+    struct epoll_event event;
+
+    // The worker goes back to the pool rather than waiting on a client
+    // that isn't reading
+    event.events = (conn->out->length ? EPOLLOUT : EPOLLIN | EPOLLRDHUP)
+        | EPOLLONESHOT;
+    event.data.ptr = conn;
+    if(epoll_ctl(server->epoll, EPOLL_CTL_MOD, conn->fd, &event) < 0)
+        server_close(server, conn);
+}
+
+// Closes a connection and deletes it
+void server_close(struct server *server, struct connection *conn)
+{
+    epoll_ctl(server->epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    buffer_delete(conn->in);
+    buffer_delete(conn->out);
+    free(conn);
+}
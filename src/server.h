@@ -0,0 +1,43 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef SERVER_H
+#define SERVER_H
+
+struct symtable;
+
+/**
+ * Server mode answers function calls over a Unix domain socket.  Each
+ * request is a single line holding a function name followed by its
+ * input written as a col constant, for example
+ *
+ *   collatz-seq 27
+ *
+ * Each response is a single line holding the function's result as a
+ * col constant, or the word error followed by a message.  A client may
+ * send any number of requests on one connection, and responses are
+ * always returned in the order the requests were sent.
+ */
+
+// Serves calls to the functions in a symtable, returns only on error
+int server_run(struct symtable *table, const char *path, int threads);
+
+#endif // SERVER_H
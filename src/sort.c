@@ -0,0 +1,887 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sort.h"
+#include "interpreter.h"
+
+// Bytes of a string that fit exactly in a double
+#define SORT_PREFIX 6
+
+// Flips the sign bit of an int, so its digits sort in unsigned order
+#define SORT_DIGITS(i) ((unsigned int)(i) ^ 0x80000000u)
+
+// Insertion sorts a short run of ints
+void sort_ints_small(int *keys, int *index, int count);
+
+// Gives the first few bytes of a string as a number, which orders strings
+// with different prefixes the same way comparing them would
+double sort_prefix(struct string *string);
+// Checks whether item a goes before item b in a quicksort
+int sort_less(enum sort_key key, struct sort_item *a, struct sort_item *b);
+
+// Quicksorts a run of items, heapsorting it instead after too many bad
+// pivots.  A run that isn't leftmost has an item before it no greater
+// than any of its own.
+void sort_quick_run(struct sort_item *begin, struct sort_item *end,
+                    enum sort_key key, int bad, int leftmost);
+// Insertion sorts a run of items, guarded if nothing smaller comes before
+// it
+void sort_insertion(struct sort_item *begin, struct sort_item *end,
+                    enum sort_key key, int guarded);
+// Insertion sorts a run of items unless it takes too many moves, returns
+// 0 if it gave up
+int sort_insertion_partial(struct sort_item *begin, struct sort_item *end,
+                           enum sort_key key);
+// Puts three items in order
+void sort_three(struct sort_item *a, struct sort_item *b,
+                struct sort_item *c, enum sort_key key);
+// Partitions a run around its first item, putting items equal to it on
+// the left, and returns where it ends up
+struct sort_item *sort_partition_left(struct sort_item *begin,
+                                      struct sort_item *end,
+                                      enum sort_key key);
+// Partitions a run around its first item, putting items equal to it on
+// the right, and returns where it ends up.  Sets partitioned if nothing
+// had to move.
+struct sort_item *sort_partition_right(struct sort_item *begin,
+                                       struct sort_item *end,
+                                       enum sort_key key, int *partitioned);
+// The same as sort_partition_right, but comparing numbers a block at a
+// time and then moving the ones on the wrong side, which avoids a hard
+// to predict branch for every comparison
+struct sort_item *sort_partition_blocks(struct sort_item *begin,
+                                        struct sort_item *end,
+                                        int *partitioned);
+// Swaps the items at num pairs of offsets from left and right
+void sort_swap_offsets(struct sort_item *left, struct sort_item *right,
+                       unsigned char *left_offsets,
+                       unsigned char *right_offsets, int num, int swaps);
+// Heapsorts a run of items
+void sort_heap(struct sort_item *begin, struct sort_item *end,
+               enum sort_key key);
+// Sifts an item down a heap with the greatest item at its root
+void sort_heap_sift(struct sort_item *items, int root, int count,
+                    enum sort_key key);
+
+// Merge sorts a run of items, using buffer for scratch space
+void sort_merge_run(struct sort_item *items, struct sort_item *buffer,
+                    int count, int (*order)(struct value*, struct value*));
+// Sifts an item down a heap with the least item at its root
+void sort_top_sift(struct sort_item *items, int root, int count,
+                   int (*order)(struct value*, struct value*));
+
+// Swaps two items
+void sort_swap(struct sort_item *a, struct sort_item *b);
+
+// Finds what a list of values is once another value is added to it
+enum sort_kind sort_classify(enum sort_kind kind, struct value *value)
+{
+    enum sort_kind next = SORT_UNORDERED;
+
+    switch(value->type)
+    {
+    case INT_VAL:
+        next = SORT_INTS;
+        break;
+    case FLOAT_VAL:
+        next = SORT_FLOATS;
+        break;
+    case CHAR_VAL:
+        next = SORT_CHARS;
+        break;
+    case STRING_VAL:
+        next = SORT_STRINGS;
+        break;
+    default:
+        return SORT_UNORDERED;
+    }
+
+    if(kind == SORT_EMPTY || kind == next)
+        return next;
+
+    // Ints and floats can be ordered against each other, nothing else can
+    if((kind == SORT_INTS || kind == SORT_FLOATS || kind == SORT_NUMBERS)
+       && (next == SORT_INTS || next == SORT_FLOATS))
+    {
+        return SORT_NUMBERS;
+    }
+
+    return SORT_UNORDERED;
+}
+
+// Compares two values the way lt does
+int sort_order(struct value *a, struct value *b)
+{
+    double x, y;
+
+    if(a->type == STRING_VAL)
+        return string_compare(&a->data.str_val, &b->data.str_val);
+    if(a->type == CHAR_VAL)
+        return (a->data.char_val > b->data.char_val)
+            - (a->data.char_val < b->data.char_val);
+
+    x = a->type == INT_VAL ? a->data.int_val : a->data.float_val;
+    y = b->type == INT_VAL ? b->data.int_val : b->data.float_val;
+    return (x > y) - (x < y);
+}
+
+// Sorts ints into ascending order, moving the matching entries of index
+// along with them if it isn't NULL.  Equal ints keep their order.
+void sort_ints(int *keys, int *index, int count)
+{
+    int counts[4][256];
+    int *key_buffer = NULL;
+    int *index_buffer = NULL;
+    int *from_keys = keys;
+    int *from_index = index;
+    int *to_keys = NULL;
+    int *to_index = NULL;
+    int *swap = NULL;
+    unsigned int digit;
+    int shift, total, position;
+    int i, j;
+
+    if(count <= SORT_SMALL)
+    {
+        sort_ints_small(keys, index, count);
+        return;
+    }
+
+    // Every pass is counted up front, least significant byte first
+    memset(counts, 0, sizeof(counts));
+    for(i = 0; i < count; i++)
+    {
+        digit = SORT_DIGITS(keys[i]);
+        counts[0][digit & 0xff]++;
+        counts[1][(digit >> 8) & 0xff]++;
+        counts[2][(digit >> 16) & 0xff]++;
+        counts[3][digit >> 24]++;
+    }
+
+    key_buffer = (int*)malloc(count * sizeof(int));
+    to_keys = key_buffer;
+    if(index)
+    {
+        index_buffer = (int*)malloc(count * sizeof(int));
+        to_index = index_buffer;
+    }
+
+    for(i = 0; i < 4; i++)
+    {
+        shift = i * 8;
+
+        // A byte that every key shares doesn't move anything
+        if(counts[i][(SORT_DIGITS(from_keys[0]) >> shift) & 0xff] == count)
+            continue;
+
+        // Counts become the position each byte's keys start at
+        total = 0;
+        for(j = 0; j < 256; j++)
+        {
+            position = counts[i][j];
+            counts[i][j] = total;
+            total += position;
+        }
+
+        for(j = 0; j < count; j++)
+        {
+            position = counts[i][(SORT_DIGITS(from_keys[j]) >> shift) & 0xff]++;
+            to_keys[position] = from_keys[j];
+            if(index)
+                to_index[position] = from_index[j];
+        }
+
+        swap = from_keys;
+        from_keys = to_keys;
+        to_keys = swap;
+        swap = from_index;
+        from_index = to_index;
+        to_index = swap;
+    }
+
+    if(from_keys != keys)
+    {
+        memcpy(keys, from_keys, count * sizeof(int));
+        if(index)
+            memcpy(index, from_index, count * sizeof(int));
+    }
+
+    free(key_buffer);
+    free(index_buffer);
+}
+
+// Insertion sorts a short run of ints
+void sort_ints_small(int *keys, int *index, int count)
+{
+    int key, position;
+    int i, j;
+
+    for(i = 1; i < count; i++)
+    {
+        key = keys[i];
+        position = index ? index[i] : 0;
+        for(j = i; j > 0 && keys[j - 1] > key; j--)
+        {
+            keys[j] = keys[j - 1];
+            if(index)
+                index[j] = index[j - 1];
+        }
+
+        keys[j] = key;
+        if(index)
+            index[j] = position;
+    }
+}
+
+// Sorts items into ascending order by their numbers or their string
+// values.  Numbers that aren't numbers go last.
+void sort_quick(struct sort_item *items, int count, enum sort_key key)
+{
+    int bad = 0;
+    int i;
+
+    if(key == SORT_BY_STRING)
+        for(i = 0; i < count; i++)
+            items[i].number = sort_prefix(&items[i].value->data.str_val);
+
+    // NaNs aren't ordered against anything, so they're moved out of the
+    // way before they can confuse the partitioning
+    if(key == SORT_BY_NUMBER)
+    {
+        for(i = 0; i < count; )
+        {
+            if(items[i].number != items[i].number)
+                sort_swap(items + i, items + --count);
+            else
+                i++;
+        }
+    }
+
+    // The number of bad pivots tolerated grows with log2 of the count
+    for(i = count; i > 1; i >>= 1)
+        bad++;
+
+    // Each key gets its own call so the compiler can specialize the
+    // comparisons for it
+    if(count < 2)
+        return;
+    else if(key == SORT_BY_NUMBER)
+        sort_quick_run(items, items + count, SORT_BY_NUMBER, bad, 1);
+    else
+        sort_quick_run(items, items + count, SORT_BY_STRING, bad, 1);
+}
+
+// Gives the first few bytes of a string as a number.  Shorter strings are
+// padded with zeroes, which puts them before any longer string they
+// start.
+double sort_prefix(struct string *string)
+{
+    const unsigned char *text = (const unsigned char*)string_text(string);
+    double prefix = 0;
+    int i;
+
+    for(i = 0; i < SORT_PREFIX; i++)
+        prefix = prefix * 256 + (i < string->length ? text[i] : 0);
+
+    return prefix;
+}
+
+// Checks whether item a goes before item b in a quicksort.  Strings are
+// compared by their prefixes first, only looking at the strings themselves
+// if those are the same.
+int sort_less(enum sort_key key, struct sort_item *a, struct sort_item *b)
+{
+    if(a->number != b->number || key == SORT_BY_NUMBER)
+        return a->number < b->number;
+
+    return string_compare(&a->value->data.str_val,
+                          &b->value->data.str_val) < 0;
+}
+
+// Quicksorts a run of items, heapsorting it instead after too many bad
+// pivots
+void sort_quick_run(struct sort_item *begin, struct sort_item *end,
+                    enum sort_key key, int bad, int leftmost)
+{
+    struct sort_item *pivot = NULL;
+    int size, half, left, right;
+    int partitioned;
+
+    while(1)
+    {
+        size = end - begin;
+        if(size < SORT_SMALL)
+        {
+            sort_insertion(begin, end, key, leftmost);
+            return;
+        }
+
+        // The pivot is the median of three, or of three medians for long
+        // runs, moved to the front
+        half = size / 2;
+        if(size > 128)
+        {
+            sort_three(begin, begin + half, end - 1, key);
+            sort_three(begin + 1, begin + half - 1, end - 2, key);
+            sort_three(begin + 2, begin + half + 1, end - 3, key);
+            sort_three(begin + half - 1, begin + half, begin + half + 1, key);
+            sort_swap(begin, begin + half);
+        }
+        else
+        {
+            sort_three(begin + half, begin, end - 1, key);
+        }
+
+        // A pivot no greater than the item before the run means the run
+        // starts with copies of that item, which can all be skipped
+        if(!leftmost && !sort_less(key, begin - 1, begin))
+        {
+            begin = sort_partition_left(begin, end, key) + 1;
+            continue;
+        }
+
+        if(key == SORT_BY_NUMBER)
+            pivot = sort_partition_blocks(begin, end, &partitioned);
+        else
+            pivot = sort_partition_right(begin, end, key, &partitioned);
+        left = pivot - begin;
+        right = end - (pivot + 1);
+
+        if(left < size / 8 || right < size / 8)
+        {
+            if(--bad == 0)
+            {
+                sort_heap(begin, end, key);
+                return;
+            }
+
+            // Swapping a few items around breaks up patterns that keep
+            // giving bad pivots
+            if(left >= SORT_SMALL)
+            {
+                sort_swap(begin, begin + left / 4);
+                sort_swap(pivot - 1, pivot - left / 4);
+                if(left > 128)
+                {
+                    sort_swap(begin + 1, begin + (left / 4 + 1));
+                    sort_swap(begin + 2, begin + (left / 4 + 2));
+                    sort_swap(pivot - 2, pivot - (left / 4 + 1));
+                    sort_swap(pivot - 3, pivot - (left / 4 + 2));
+                }
+            }
+
+            if(right >= SORT_SMALL)
+            {
+                sort_swap(pivot + 1, pivot + (1 + right / 4));
+                sort_swap(end - 1, end - right / 4);
+                if(right > 128)
+                {
+                    sort_swap(pivot + 2, pivot + (2 + right / 4));
+                    sort_swap(pivot + 3, pivot + (3 + right / 4));
+                    sort_swap(end - 2, end - (1 + right / 4));
+                    sort_swap(end - 3, end - (2 + right / 4));
+                }
+            }
+        }
+        else if(partitioned && sort_insertion_partial(begin, pivot, key)
+                && sort_insertion_partial(pivot + 1, end, key))
+        {
+            // The run was close enough to sorted already
+            return;
+        }
+
+        sort_quick_run(begin, pivot, key, bad, leftmost);
+        begin = pivot + 1;
+        leftmost = 0;
+    }
+}
+
+// Insertion sorts a run of items, guarded if nothing smaller comes before
+// it
+void sort_insertion(struct sort_item *begin, struct sort_item *end,
+                    enum sort_key key, int guarded)
+{
+    struct sort_item *current = NULL;
+    struct sort_item *sift = NULL;
+    struct sort_item item;
+
+    for(current = begin + 1; current < end; current++)
+    {
+        if(!sort_less(key, current, current - 1))
+            continue;
+
+        item = *current;
+        sift = current;
+        do
+        {
+            *sift = *(sift - 1);
+            sift--;
+        } while((!guarded || sift != begin) && sort_less(key, &item, sift - 1));
+        *sift = item;
+    }
+}
+
+// Insertion sorts a run of items unless it takes too many moves, returns
+// 0 if it gave up
+int sort_insertion_partial(struct sort_item *begin, struct sort_item *end,
+                           enum sort_key key)
+{
+    struct sort_item *current = NULL;
+    struct sort_item *sift = NULL;
+    struct sort_item item;
+    int moves = 0;
+
+    for(current = begin + 1; current < end; current++)
+    {
+        if(!sort_less(key, current, current - 1))
+            continue;
+
+        item = *current;
+        sift = current;
+        do
+        {
+            *sift = *(sift - 1);
+            sift--;
+        } while(sift != begin && sort_less(key, &item, sift - 1));
+        *sift = item;
+
+        moves += current - sift;
+        if(moves > 8)
+            return 0;
+    }
+
+    return 1;
+}
+
+// Puts three items in order
+void sort_three(struct sort_item *a, struct sort_item *b,
+                struct sort_item *c, enum sort_key key)
+{
+    if(sort_less(key, b, a))
+        sort_swap(a, b);
+    if(sort_less(key, c, b))
+        sort_swap(b, c);
+    if(sort_less(key, b, a))
+        sort_swap(a, b);
+}
+
+// Partitions a run around its first item, putting items equal to it on
+// the left, and returns where it ends up
+struct sort_item *sort_partition_left(struct sort_item *begin,
+                                      struct sort_item *end,
+                                      enum sort_key key)
+{
+    struct sort_item pivot = *begin;
+    struct sort_item *first = begin;
+    struct sort_item *last = end;
+
+    while(sort_less(key, &pivot, --last))
+        ;
+
+    if(last + 1 == end)
+        while(first < last && !sort_less(key, &pivot, ++first))
+            ;
+    else
+        while(!sort_less(key, &pivot, ++first))
+            ;
+
+    while(first < last)
+    {
+        sort_swap(first, last);
+        while(sort_less(key, &pivot, --last))
+            ;
+        while(!sort_less(key, &pivot, ++first))
+            ;
+    }
+
+    *begin = *last;
+    *last = pivot;
+    return last;
+}
+
+// Partitions a run around its first item, putting items equal to it on
+// the right, and returns where it ends up
+struct sort_item *sort_partition_right(struct sort_item *begin,
+                                       struct sort_item *end,
+                                       enum sort_key key, int *partitioned)
+{
+    struct sort_item pivot = *begin;
+    struct sort_item *first = begin;
+    struct sort_item *last = end;
+
+    // The median of three left something no less than the pivot at the
+    // end of the run, so the first scan can't run off it
+    while(sort_less(key, ++first, &pivot))
+        ;
+
+    if(first - 1 == begin)
+        while(first < last && !sort_less(key, --last, &pivot))
+            ;
+    else
+        while(!sort_less(key, --last, &pivot))
+            ;
+
+    *partitioned = first >= last;
+    while(first < last)
+    {
+        sort_swap(first, last);
+        while(sort_less(key, ++first, &pivot))
+            ;
+        while(!sort_less(key, --last, &pivot))
+            ;
+    }
+
+    last = first - 1;
+    *begin = *last;
+    *last = pivot;
+    return last;
+}
+
+// The same as sort_partition_right, but comparing numbers a block at a
+// time
+struct sort_item *sort_partition_blocks(struct sort_item *begin,
+                                        struct sort_item *end,
+                                        int *partitioned)
+{
+    unsigned char left_offsets[SORT_BLOCK];
+    unsigned char right_offsets[SORT_BLOCK];
+    struct sort_item pivot = *begin;
+    struct sort_item *first = begin;
+    struct sort_item *last = end;
+    struct sort_item *left_base = NULL;
+    struct sort_item *right_base = NULL;
+    int left_count = 0;
+    int right_count = 0;
+    int left_start = 0;
+    int right_start = 0;
+    int unknown, left_split, right_split, num;
+    int i;
+
+    while((++first)->number < pivot.number)
+        ;
+
+    if(first - 1 == begin)
+        while(first < last && !((--last)->number < pivot.number))
+            ;
+    else
+        while(!((--last)->number < pivot.number))
+            ;
+
+    *partitioned = first >= last;
+    if(!*partitioned)
+    {
+        sort_swap(first, last);
+        first++;
+
+        left_base = first;
+        right_base = last;
+        while(first < last)
+        {
+            // Each side with no misplaced items left over scans another
+            // block, or splits what's left with the other side
+            unknown = last - first;
+            left_split = left_count ? 0
+                : (right_count ? unknown : unknown / 2);
+            right_split = right_count ? 0 : unknown - left_split;
+            if(left_split > SORT_BLOCK)
+                left_split = SORT_BLOCK;
+            if(right_split > SORT_BLOCK)
+                right_split = SORT_BLOCK;
+
+            // Offsets of misplaced items are always written, but only
+            // kept by counting them
+            for(i = 0; i < left_split; i++, first++)
+            {
+                left_offsets[left_count] = i;
+                left_count += !(first->number < pivot.number);
+            }
+
+            for(i = 0; i < right_split; )
+            {
+                right_offsets[right_count] = ++i;
+                right_count += (--last)->number < pivot.number;
+            }
+
+            num = left_count < right_count ? left_count : right_count;
+            sort_swap_offsets(left_base, right_base,
+                              left_offsets + left_start,
+                              right_offsets + right_start, num,
+                              left_count == right_count);
+            left_count -= num;
+            right_count -= num;
+            left_start += num;
+            right_start += num;
+
+            if(!left_count)
+            {
+                left_start = 0;
+                left_base = first;
+            }
+            if(!right_count)
+            {
+                right_start = 0;
+                right_base = last;
+            }
+        }
+
+        // Whatever's still misplaced on one side goes at the boundary
+        if(left_count)
+        {
+            while(left_count--)
+                sort_swap(left_base + left_offsets[left_start + left_count],
+                          --last);
+            first = last;
+        }
+        if(right_count)
+        {
+            while(right_count--)
+            {
+                sort_swap(right_base
+                          - right_offsets[right_start + right_count], first);
+                first++;
+            }
+            last = first;
+        }
+    }
+
+    last = first - 1;
+    *begin = *last;
+    *last = pivot;
+    return last;
+}
+
+// Swaps the items at num pairs of offsets from left and right
+void sort_swap_offsets(struct sort_item *left, struct sort_item *right,
+                       unsigned char *left_offsets,
+                       unsigned char *right_offsets, int num, int swaps)
+{
+    struct sort_item *l = NULL;
+    struct sort_item *r = NULL;
+    struct sort_item item;
+    int i;
+
+    // Plain swaps keep descending runs from going quadratic
+    if(swaps)
+    {
+        for(i = 0; i < num; i++)
+            sort_swap(left + left_offsets[i], right - right_offsets[i]);
+        return;
+    }
+
+    // Otherwise the items are rotated through, one move each
+    if(!num)
+        return;
+
+    l = left + left_offsets[0];
+    r = right - right_offsets[0];
+    item = *l;
+    *l = *r;
+    for(i = 1; i < num; i++)
+    {
+        l = left + left_offsets[i];
+        *r = *l;
+        r = right - right_offsets[i];
+        *l = *r;
+    }
+    *r = item;
+}
+
+// Heapsorts a run of items
+void sort_heap(struct sort_item *begin, struct sort_item *end,
+               enum sort_key key)
+{
+    int count = end - begin;
+    int i;
+
+    for(i = count / 2 - 1; i >= 0; i--)
+        sort_heap_sift(begin, i, count, key);
+
+    for(i = count - 1; i > 0; i--)
+    {
+        sort_swap(begin, begin + i);
+        sort_heap_sift(begin, 0, i, key);
+    }
+}
+
+// Sifts an item down a heap with the greatest item at its root
+void sort_heap_sift(struct sort_item *items, int root, int count,
+                    enum sort_key key)
+{
+    int child;
+
+    while((child = 2 * root + 1) < count)
+    {
+        if(child + 1 < count
+           && sort_less(key, items + child, items + child + 1))
+        {
+            child++;
+        }
+
+        if(!sort_less(key, items + root, items + child))
+            return;
+
+        sort_swap(items + root, items + child);
+        root = child;
+    }
+}
+
+// Sorts items into ascending order by their values, as compared by order.
+// Equal items keep their order.
+void sort_merge(struct sort_item *items, int count,
+                int (*order)(struct value *a, struct value *b))
+{
+    struct sort_item *buffer = NULL;
+
+    if(count < 2)
+        return;
+
+    buffer = (struct sort_item*)malloc((count / 2) * sizeof(struct sort_item));
+    sort_merge_run(items, buffer, count, order);
+    free(buffer);
+}
+
+// Merge sorts a run of items, using buffer for scratch space
+void sort_merge_run(struct sort_item *items, struct sort_item *buffer,
+                    int count, int (*order)(struct value*, struct value*))
+{
+    struct sort_item item;
+    int half = count / 2;
+    int i, j, k;
+
+    if(count <= SORT_SMALL)
+    {
+        for(i = 1; i < count; i++)
+        {
+            item = items[i];
+            for(j = i; j > 0 && order(items[j - 1].value, item.value) > 0; j--)
+                items[j] = items[j - 1];
+            items[j] = item;
+        }
+        return;
+    }
+
+    sort_merge_run(items, buffer, half, order);
+    sort_merge_run(items + half, buffer, count - half, order);
+
+    // Halves that are already in order don't need merging
+    if(order(items[half - 1].value, items[half].value) <= 0)
+        return;
+
+    // Only the left half needs moving aside, the merge never catches up
+    // with the right
+    memcpy(buffer, items, half * sizeof(struct sort_item));
+    i = 0;
+    j = half;
+    k = 0;
+    while(i < half && j < count)
+    {
+        // Ties are taken from the left to keep the sort stable
+        if(order(items[j].value, buffer[i].value) < 0)
+            items[k++] = items[j++];
+        else
+            items[k++] = buffer[i++];
+    }
+
+    while(i < half)
+        items[k++] = buffer[i++];
+}
+
+// Offers a value to a heap of the greatest values seen so far, which
+// holds size of them and has room for k, and returns its new size
+int sort_top_offer(struct sort_item *heap, int size, int k,
+                   struct value *value,
+                   int (*order)(struct value *a, struct value *b))
+{
+    int i, parent;
+
+    // Until the heap fills up everything goes in, sifting up from the
+    // bottom
+    if(size < k)
+    {
+        for(i = size; i > 0; i = parent)
+        {
+            parent = (i - 1) / 2;
+            if(order(heap[parent].value, value) <= 0)
+                break;
+            heap[i] = heap[parent];
+        }
+
+        heap[i].value = value;
+        return size + 1;
+    }
+
+    // After that a value only goes in if it's greater than the least one
+    if(k && order(value, heap[0].value) > 0)
+    {
+        heap[0].value = value;
+        sort_top_sift(heap, 0, size, order);
+    }
+
+    return size;
+}
+
+// Puts a heap of the greatest values into descending order
+void sort_top_order(struct sort_item *heap, int size,
+                    int (*order)(struct value *a, struct value *b))
+{
+    int i;
+
+    // Taking the least off the end each time leaves the rest in order
+    for(i = size - 1; i > 0; i--)
+    {
+        sort_swap(heap, heap + i);
+        sort_top_sift(heap, 0, i, order);
+    }
+}
+
+// Sifts an item down a heap with the least item at its root
+void sort_top_sift(struct sort_item *items, int root, int count,
+                   int (*order)(struct value*, struct value*))
+{
+    int child;
+
+    while((child = 2 * root + 1) < count)
+    {
+        if(child + 1 < count
+           && order(items[child + 1].value, items[child].value) < 0)
+        {
+            child++;
+        }
+
+        if(order(items[root].value, items[child].value) <= 0)
+            return;
+
+        sort_swap(items + root, items + child);
+        root = child;
+    }
+}
+
+// Swaps two items
+void sort_swap(struct sort_item *a, struct sort_item *b)
+{
+    struct sort_item item = *a;
+
+    *a = *b;
+    *b = item;
+}
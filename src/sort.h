@@ -0,0 +1,96 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef SORT_H
+#define SORT_H
+
+#define SORT_SMALL 24 // Longest run sorted by insertion
+#define SORT_BLOCK 64 // Numbers compared at once when partitioning
+
+/**
+ * Sorting algorithms for the sort primitives.  Ints, and characters
+ * treated as ints, are radix sorted.  Floats and strings are sorted with
+ * pattern-defeating quicksort, which is fast on random input and close to
+ * linear on runs that are already sorted.  Anything else is merge sorted
+ * with a comparison function, which keeps equal elements in order.
+ */
+
+struct value;
+
+// An element being sorted, with the number or value it's ordered by and
+// where it came from
+struct sort_item
+{
+    double number;
+    struct value *value;
+    int index;
+};
+
+// What sort_quick orders items by
+enum sort_key
+{
+    SORT_BY_NUMBER,
+    SORT_BY_STRING
+};
+
+// What a list of values to be sorted holds
+enum sort_kind
+{
+    SORT_EMPTY,     // No values at all
+    SORT_UNORDERED, // Values that can't be ordered against each other
+    SORT_INTS,
+    SORT_CHARS,
+    SORT_FLOATS,
+    SORT_STRINGS,
+    SORT_NUMBERS    // Both ints and floats
+};
+
+// Finds what a list of values is once another value is added to it,
+// starting from SORT_EMPTY.  This decides how they can be sorted.
+enum sort_kind sort_classify(enum sort_kind kind, struct value *value);
+// Compares two values the way lt does, returns less than, equal to or
+// greater than zero.  The values must be of a kind sort_classify accepts.
+int sort_order(struct value *a, struct value *b);
+
+// Sorts ints into ascending order, moving the matching entries of index
+// along with them if it isn't NULL.  Equal ints keep their order.
+void sort_ints(int *keys, int *index, int count);
+// Sorts items into ascending order by their numbers or their string
+// values, which replaces their numbers with the first bytes of their
+// strings.  Numbers that aren't numbers go last.  Equal items may be
+// reordered.
+void sort_quick(struct sort_item *items, int count, enum sort_key key);
+// Sorts items into ascending order by their values, as compared by order,
+// which returns less than, equal to or greater than zero.  Equal items
+// keep their order.
+void sort_merge(struct sort_item *items, int count,
+                int (*order)(struct value *a, struct value *b));
+// Offers a value to a heap of the greatest values seen so far, as
+// compared by order, which holds size of them and has room for k.
+// Returns the heap's new size.
+int sort_top_offer(struct sort_item *heap, int size, int k,
+                   struct value *value,
+                   int (*order)(struct value *a, struct value *b));
+// Puts a heap of the greatest values into descending order
+void sort_top_order(struct sort_item *heap, int size,
+                    int (*order)(struct value *a, struct value *b));
+
+#endif // SORT_H
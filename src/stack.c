@@ -0,0 +1,202 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include "stack.h"
+#include "interpreter.h"
+#include "io.h"
+
+// A stack segment, along with the call running on it
+struct stack_segment
+{
+    char *base;
+    ucontext_t context;
+    // Where to go back to when the call is finished
+    ucontext_t caller;
+    char *caller_limit;
+    struct function *function;
+    struct value *in;
+    struct value *out;
+};
+
+__thread char *STACK_LIMIT __attribute__((tls_model("initial-exec"))) = NULL;
+
+// Segments by depth, those at STACK_DEPTH and beyond are spares
+__thread struct stack_segment *STACK_SEGMENTS[STACK_MAX_SEGMENTS];
+// Number of segments in use
+__thread int STACK_DEPTH = 0;
+
+int STACK_SEGMENT_LIMIT = STACK_DEFAULT_SEGMENTS;
+
+// Frees a thread's segments when it exits
+pthread_key_t STACK_KEY;
+pthread_once_t STACK_KEY_ONCE = PTHREAD_ONCE_INIT;
+
+// Finds the limit of the thread's own stack
+void stack_init();
+// Creates the key whose destructor frees a thread's segments
+void stack_key_create();
+// Frees every segment in a thread's table, run as the thread exits
+void stack_release(void *segments);
+// Allocates a stack segment, returns NULL if there's no memory for it
+struct stack_segment *stack_segment_new();
+// Frees a stack segment
+void stack_segment_delete(struct stack_segment *segment);
+// Entry point of a new segment, runs the call waiting in it
+void stack_run();
+
+// Executes a function on a new stack segment, or on the current stack if
+// it turns out to have enough room
+struct value *stack_exec(struct function *function, struct value *in)
+{
+    struct stack_segment *segment = NULL;
+    const char *error = "Error: Recursion too deep";
+
+    if(!STACK_LIMIT)
+    {
+        stack_init();
+        if(!STACK_LOW(&segment))
+            return function_exec(function, in);
+    }
+
+    if(STACK_DEPTH < STACK_SEGMENT_LIMIT)
+    {
+        segment = STACK_SEGMENTS[STACK_DEPTH];
+        if(!segment)
+            segment = STACK_SEGMENTS[STACK_DEPTH] = stack_segment_new();
+    }
+
+    if(!segment)
+    {
+        io_write_line(&IO_STDERR, error, strlen(error));
+        value_delete(in);
+        return value_new();
+    }
+
+    segment->function = function;
+    segment->in = in;
+    segment->caller_limit = STACK_LIMIT;
+
+    getcontext(&segment->context);
+    segment->context.uc_stack.ss_sp = segment->base;
+    segment->context.uc_stack.ss_size = STACK_SEGMENT_SIZE;
+    segment->context.uc_link = &segment->caller;
+    makecontext(&segment->context, stack_run, 0);
+
+    STACK_DEPTH++;
+    STACK_LIMIT = segment->base + STACK_RESERVE;
+    swapcontext(&segment->caller, &segment->context);
+    STACK_LIMIT = segment->caller_limit;
+    STACK_DEPTH--;
+
+    // This segment stays as a spare, anything deeper is released
+    if(STACK_DEPTH + 1 < STACK_MAX_SEGMENTS && STACK_SEGMENTS[STACK_DEPTH + 1])
+    {
+        stack_segment_delete(STACK_SEGMENTS[STACK_DEPTH + 1]);
+        STACK_SEGMENTS[STACK_DEPTH + 1] = NULL;
+    }
+
+    return segment->out;
+}
+
+// Finds the limit of the thread's own stack
+void stack_init()
+{
+    pthread_attr_t attr;
+    void *addr = NULL;
+    size_t size = 0;
+
+    // Spare segments outlive the calls that use them, so they're only
+    // freed once the thread is done with them
+    pthread_once(&STACK_KEY_ONCE, stack_key_create);
+    pthread_setspecific(STACK_KEY, STACK_SEGMENTS);
+
+    // Without knowing where the stack ends, it's never considered low
+    if(pthread_getattr_np(pthread_self(), &attr))
+    {
+        STACK_LIMIT = (char*)1;
+        return;
+    }
+
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    STACK_LIMIT = (char*)addr + STACK_RESERVE;
+}
+
+// Creates the key whose destructor frees a thread's segments
+void stack_key_create()
+{
+    pthread_key_create(&STACK_KEY, stack_release);
+}
+
+// Frees every segment in a thread's table, run as the thread exits
+void stack_release(void *segments)
+{
+    struct stack_segment **table = (struct stack_segment**)segments;
+    int i;
+
+    for(i = 0; i < STACK_MAX_SEGMENTS; i++)
+    {
+        if(table[i])
+        {
+            stack_segment_delete(table[i]);
+            table[i] = NULL;
+        }
+    }
+}
+
+// Allocates a stack segment, returns NULL if there's no memory for it
+struct stack_segment *stack_segment_new()
+{
+    struct stack_segment *segment = NULL;
+    void *base = mmap(NULL, STACK_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                      -1, 0);
+
+    if(base == MAP_FAILED)
+        return NULL;
+
+    segment = (struct stack_segment*)malloc(sizeof(struct stack_segment));
+    segment->base = (char*)base;
+    return segment;
+}
+
+// Frees a stack segment
+void stack_segment_delete(struct stack_segment *segment)
+{
+    munmap(segment->base, STACK_SEGMENT_SIZE);
+    free(segment);
+}
+
+// Entry point of a new segment, runs the call waiting in it
+void stack_run()
+{
+    struct stack_segment *segment = STACK_SEGMENTS[STACK_DEPTH - 1];
+
+    segment->out = function_exec(segment->function, segment->in);
+}
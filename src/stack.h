@@ -0,0 +1,64 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef STACK_H
+#define STACK_H
+
+#define STACK_SEGMENT_SIZE (32 << 20) // Bytes in each heap stack segment
+#define STACK_RESERVE (256 << 10)     // Bytes left free at a stack's end
+#define STACK_MAX_SEGMENTS 128        // Most segments a thread can ever use
+#define STACK_DEFAULT_SEGMENTS 8      // Segments a thread may use by default
+
+/**
+ * Segmented stacks for deep recursion.  Every call to function_exec
+ * checks how much of the current stack is left, and once it runs low the
+ * call carries on in a fresh segment allocated from the heap, returning
+ * to the old stack when it's done.  Recursion is then limited by memory
+ * rather than by the size of the thread's stack, and by a limit on the
+ * number of segments, which is kept low by default so that runaway
+ * recursion fails quickly.  Past the last segment, calls return bottom
+ * with an error instead of crashing.
+ *
+ * Each thread tracks its own stacks.  Segments are kept for reuse, but
+ * no more than one spare beyond the deepest in use, and all of them are
+ * freed when the thread exits.
+ */
+
+struct value;
+struct function;
+
+// Lowest usable address of the current stack, NULL until it's known.
+// It's read on every call, so it uses the initial-exec TLS model, which
+// avoids a call to __tls_get_addr from within the shared library.
+extern __thread char *STACK_LIMIT __attribute__((tls_model("initial-exec")));
+
+// Number of segments each thread may use, at most STACK_MAX_SEGMENTS
+extern int STACK_SEGMENT_LIMIT;
+
+// Checks whether the stack holding a local variable is close to running
+// out, or hasn't been measured yet
+#define STACK_LOW(local) ((char*)(local) < STACK_LIMIT || !STACK_LIMIT)
+
+// Executes a function on a new stack segment, or on the current stack if
+// it turns out to have enough room
+struct value *stack_exec(struct function *function, struct value *in);
+
+#endif // STACK_H
@@ -0,0 +1,539 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "stream.h"
+#include "interpreter.h"
+#include "list.h"
+#include "io.h"
+
+// State of a range stream
+struct stream_range
+{
+    int next;
+    int end;
+};
+
+// Input shared between the copies of a line stream, along with the lines
+// some copies have read but others haven't yet.  Lines are only kept while
+// there's more than one copy, and buffer[0] is line number first.
+struct stream_input
+{
+    int refs;
+    struct io_input *input;
+    // Number of lines read from the input so far
+    int read;
+    struct value **buffer;
+    int first;
+    int count;
+    int capacity;
+};
+
+// State of one copy of a line stream
+struct stream_lines
+{
+    struct stream_input *shared;
+    // Number of the next line this copy reads
+    int position;
+};
+
+// State of a mapped or filtered stream
+struct stream_map
+{
+    struct value *source;
+    struct function *function;
+    // Set once a filter's predicate fails, after which it's finished
+    int failed;
+};
+
+// State of an unfold stream, the seed is NULL once it's finished
+struct stream_unfold
+{
+    struct value *seed;
+    struct function *stop;
+    struct function *emit;
+    struct function *step;
+};
+
+// Generator functions for range streams
+struct value *range_next(struct stream *stream);
+struct stream *range_clone(struct stream *stream);
+void range_free(struct stream *stream);
+// Generator functions for line streams
+struct value *lines_next(struct stream *stream);
+struct stream *lines_clone(struct stream *stream);
+void lines_free(struct stream *stream);
+// Reads the next line of a line stream's input, with its lock held
+struct value *lines_read(struct stream_input *shared);
+// Generator functions for mapped streams
+struct value *map_next(struct stream *stream);
+struct stream *map_clone(struct stream *stream);
+void map_free(struct stream *stream);
+// Generator function for filtered streams, which share the rest with
+// mapped streams
+struct value *filter_next(struct stream *stream);
+// Generator functions for unfold streams
+struct value *unfold_next(struct stream *stream);
+struct stream *unfold_clone(struct stream *stream);
+void unfold_free(struct stream *stream);
+
+// Creates a stream around a generator, clone may be NULL
+struct stream *stream_new(struct value *(*next)(struct stream*),
+                          struct stream *(*clone)(struct stream*),
+                          void (*free)(struct stream*), void *state)
+{
+    struct stream *stream = (struct stream*)malloc(sizeof(struct stream));
+
+    stream->refs = 1;
+    stream->next = next;
+    stream->clone = clone;
+    stream->free = free;
+    stream->state = state;
+    return stream;
+}
+
+// Wraps a stream in a new value, taking ownership of it
+struct value *stream_value(struct stream *stream)
+{
+    struct value *value = value_new();
+
+    value->type = STREAM_VAL;
+    value->data.stream_val = stream;
+    return value;
+}
+
+// Pulls the next element from a stream, returns NULL at its end
+struct value *stream_next(struct stream *stream)
+{
+    return stream->next(stream);
+}
+
+// Copies a stream, cloning it if possible and sharing it otherwise
+struct stream *stream_copy(struct stream *stream)
+{
+    struct stream *copy = NULL;
+
+    if(stream->clone)
+        copy = stream->clone(stream);
+    if(copy)
+        return copy;
+
+    stream->refs++;
+    return stream;
+}
+
+// Releases a reference to a stream, freeing it with the last one
+void stream_release(struct stream *stream)
+{
+    if(--stream->refs > 0)
+        return;
+
+    stream->free(stream);
+    free(stream);
+}
+
+// Pulls every element of a stream value into a sequence, consuming the
+// stream, or gives bottom if any element is bottom.  Any other value is
+// returned as it is.
+struct value *stream_materialize(struct value *value)
+{
+    struct value *out = NULL;
+    struct value *element = NULL;
+
+    if(value->type != STREAM_VAL)
+        return value;
+
+    out = value_new();
+    out->type = SEQ_VAL;
+    out->data.seq_val = list_new();
+    while((element = stream_next(value->data.stream_val)))
+    {
+        // A bottom element makes the whole sequence bottom, so there's no
+        // need to pull the rest
+        if(value_is_bottom(element))
+        {
+            value_delete(element);
+            value_delete(out);
+            out = value_new();
+            break;
+        }
+        list_push_back(out->data.seq_val, element);
+    }
+
+    value_delete(value);
+    return out;
+}
+
+// Streams the integers from start up to, but not including, end
+struct value *stream_range(int start, int end)
+{
+    struct stream_range *range =
+        (struct stream_range*)malloc(sizeof(struct stream_range));
+
+    range->next = start;
+    range->end = end;
+    return stream_value(stream_new(range_next, range_clone, range_free,
+                                   range));
+}
+
+// Returns the next integer of a range
+struct value *range_next(struct stream *stream)
+{
+    struct stream_range *range = (struct stream_range*)stream->state;
+    struct value *value = NULL;
+
+    if(range->next >= range->end)
+        return NULL;
+
+    value = value_new();
+    value->type = INT_VAL;
+    value->data.int_val = range->next++;
+    return value;
+}
+
+// Copies a range along with its position
+struct stream *range_clone(struct stream *stream)
+{
+    struct stream_range *range = (struct stream_range*)stream->state;
+    struct stream_range *copy =
+        (struct stream_range*)malloc(sizeof(struct stream_range));
+
+    *copy = *range;
+    return stream_new(range_next, range_clone, range_free, copy);
+}
+
+// Frees a range
+void range_free(struct stream *stream)
+{
+    free(stream->state);
+}
+
+// Streams the lines of a file, or of standard input if path is NULL.
+// Returns NULL if the file can't be opened.
+struct value *stream_lines(const char *path)
+{
+    struct io_input *input = &IO_STDIN;
+    struct stream_input *shared = NULL;
+    struct stream_lines *lines = NULL;
+
+    if(path)
+        input = io_input_open(path);
+    if(!input)
+        return NULL;
+
+    shared = (struct stream_input*)malloc(sizeof(struct stream_input));
+    shared->refs = 1;
+    shared->input = input;
+    shared->read = 0;
+    shared->buffer = NULL;
+    shared->first = 0;
+    shared->count = 0;
+    shared->capacity = 0;
+
+    lines = (struct stream_lines*)malloc(sizeof(struct stream_lines));
+    lines->shared = shared;
+    lines->position = 0;
+    return stream_value(stream_new(lines_next, lines_clone, lines_free,
+                                   lines));
+}
+
+// Returns the next line for one copy of a line stream, from the lines
+// buffered for it if other copies have already read past it
+struct value *lines_next(struct stream *stream)
+{
+    struct stream_lines *lines = (struct stream_lines*)stream->state;
+    struct stream_input *shared = lines->shared;
+    struct value *value = NULL;
+    int i;
+
+    pthread_mutex_lock(&shared->input->lock);
+
+    if(lines->position < shared->first + shared->count)
+    {
+        value = value_copy(shared->buffer[lines->position - shared->first]);
+        lines->position++;
+    }
+    else
+    {
+        value = lines_read(shared);
+        if(value)
+            lines->position++;
+    }
+
+    // Once the last copy has caught up, nothing else needs the lines
+    if(shared->refs == 1 && lines->position >= shared->first + shared->count)
+    {
+        for(i = 0; i < shared->count; i++)
+            value_delete(shared->buffer[i]);
+        shared->count = 0;
+    }
+
+    pthread_mutex_unlock(&shared->input->lock);
+    return value;
+}
+
+// Reads the next line of a line stream's input, with its lock held
+struct value *lines_read(struct stream_input *shared)
+{
+    struct value *value = NULL;
+    const char *line = NULL;
+    int length;
+
+    line = io_read_line(shared->input, &length);
+    if(!line)
+        return NULL;
+
+    value = value_new();
+    value->type = STRING_VAL;
+    string_init(&value->data.str_val, line, length);
+
+    // Other copies will want the line when they get this far
+    if(shared->refs > 1)
+    {
+        if(!shared->count)
+            shared->first = shared->read;
+        if(shared->count == shared->capacity)
+        {
+            shared->capacity = shared->capacity ? shared->capacity * 2 : 16;
+            shared->buffer = (struct value**)realloc(
+                shared->buffer, shared->capacity * sizeof(struct value*));
+        }
+        shared->buffer[shared->count++] = value_copy(value);
+    }
+
+    shared->read++;
+    return value;
+}
+
+// Copies a line stream along with its position, sharing its input
+struct stream *lines_clone(struct stream *stream)
+{
+    struct stream_lines *lines = (struct stream_lines*)stream->state;
+    struct stream_lines *copy =
+        (struct stream_lines*)malloc(sizeof(struct stream_lines));
+
+    pthread_mutex_lock(&lines->shared->input->lock);
+    lines->shared->refs++;
+    pthread_mutex_unlock(&lines->shared->input->lock);
+
+    *copy = *lines;
+    return stream_new(lines_next, lines_clone, lines_free, copy);
+}
+
+// Frees a copy of a line stream, and with the last one its buffered lines
+// and its file, standard input is left open
+void lines_free(struct stream *stream)
+{
+    struct stream_lines *lines = (struct stream_lines*)stream->state;
+    struct stream_input *shared = lines->shared;
+    int refs;
+    int i;
+
+    pthread_mutex_lock(&shared->input->lock);
+    refs = --shared->refs;
+    pthread_mutex_unlock(&shared->input->lock);
+    free(lines);
+
+    if(refs > 0)
+        return;
+
+    for(i = 0; i < shared->count; i++)
+        value_delete(shared->buffer[i]);
+    free(shared->buffer);
+    if(shared->input != &IO_STDIN)
+        io_input_close(shared->input);
+    free(shared);
+}
+
+// Streams the results of applying a function to each element of a
+// stream, taking ownership of the source
+struct value *stream_map(struct value *source, struct function *function)
+{
+    struct stream_map *map =
+        (struct stream_map*)malloc(sizeof(struct stream_map));
+
+    map->source = source;
+    map->function = function;
+    map->failed = 0;
+    return stream_value(stream_new(map_next, map_clone, map_free, map));
+}
+
+// Applies the mapped function to the next element of the source
+struct value *map_next(struct stream *stream)
+{
+    struct stream_map *map = (struct stream_map*)stream->state;
+    struct value *element = stream_next(map->source->data.stream_val);
+
+    if(!element)
+        return NULL;
+
+    return stream_materialize(function_exec(map->function, element));
+}
+
+// Streams the elements of a stream for which a predicate is True, taking
+// ownership of the source.  If the predicate doesn't give a boolean for an
+// element, the stream fails: it ends with a bottom element, which makes
+// anything reading it whole bottom.
+struct value *stream_filter(struct value *source, struct function *predicate)
+{
+    struct stream_map *map =
+        (struct stream_map*)malloc(sizeof(struct stream_map));
+
+    map->source = source;
+    map->function = predicate;
+    map->failed = 0;
+    return stream_value(stream_new(filter_next, map_clone, map_free, map));
+}
+
+// Pulls elements from the source until the predicate accepts one
+struct value *filter_next(struct stream *stream)
+{
+    struct stream_map *map = (struct stream_map*)stream->state;
+    struct value *element = NULL;
+    struct value *test = NULL;
+
+    if(map->failed)
+        return NULL;
+
+    while((element = stream_next(map->source->data.stream_val)))
+    {
+        test = function_exec(map->function, value_copy(element));
+        if(test->type != BOOL_VAL)
+        {
+            value_delete(test);
+            value_delete(element);
+            map->failed = 1;
+            return value_new();
+        }
+
+        if(test->data.bool_val)
+        {
+            value_delete(test);
+            return element;
+        }
+
+        value_delete(test);
+        value_delete(element);
+    }
+
+    return NULL;
+}
+
+// A mapped or filtered stream can only be cloned if its source can
+struct stream *map_clone(struct stream *stream)
+{
+    struct stream_map *map = (struct stream_map*)stream->state;
+    struct stream *source = map->source->data.stream_val;
+    struct stream *copy = NULL;
+
+    if(!source->clone || !(copy = source->clone(source)))
+        return NULL;
+
+    map = (struct stream_map*)malloc(sizeof(struct stream_map));
+    map->source = stream_value(copy);
+    map->function = ((struct stream_map*)stream->state)->function;
+    map->failed = ((struct stream_map*)stream->state)->failed;
+    return stream_new(stream->next, map_clone, map_free, map);
+}
+
+// Frees a mapped stream along with its source
+void map_free(struct stream *stream)
+{
+    value_delete(((struct stream_map*)stream->state)->source);
+    free(stream->state);
+}
+
+// Streams the elements of unfold{ stop, emit, step } from a seed, taking
+// ownership of the seed.  A bottom element, or a bottom in place of the
+// test's boolean, is the last element of the stream.
+struct value *stream_unfold(struct value *seed, struct function *stop,
+                            struct function *emit, struct function *step)
+{
+    struct stream_unfold *unfold =
+        (struct stream_unfold*)malloc(sizeof(struct stream_unfold));
+
+    unfold->seed = seed;
+    unfold->stop = stop;
+    unfold->emit = emit;
+    unfold->step = step;
+    return stream_value(stream_new(unfold_next, unfold_clone, unfold_free,
+                                   unfold));
+}
+
+// Emits the element for the current seed and steps it
+struct value *unfold_next(struct stream *stream)
+{
+    struct stream_unfold *unfold = (struct stream_unfold*)stream->state;
+    struct value *test = NULL;
+    struct value *element = NULL;
+
+    if(!unfold->seed)
+        return NULL;
+
+    test = function_exec(unfold->stop, value_copy(unfold->seed));
+    if(test->type == BOOL_VAL && !test->data.bool_val)
+    {
+        element = function_exec(unfold->emit, value_copy(unfold->seed));
+        if(value_is_bottom(element))
+        {
+            value_delete(test);
+            value_delete(unfold->seed);
+            unfold->seed = NULL;
+            return element;
+        }
+        unfold->seed = function_exec(unfold->step, unfold->seed);
+    }
+    else
+    {
+        if(test->type != BOOL_VAL)
+            element = value_new();
+        value_delete(unfold->seed);
+        unfold->seed = NULL;
+    }
+
+    value_delete(test);
+    return element;
+}
+
+// Copies an unfold along with its current seed
+struct stream *unfold_clone(struct stream *stream)
+{
+    struct stream_unfold *unfold = (struct stream_unfold*)stream->state;
+    struct stream_unfold *copy =
+        (struct stream_unfold*)malloc(sizeof(struct stream_unfold));
+
+    *copy = *unfold;
+    if(unfold->seed)
+        copy->seed = value_copy(unfold->seed);
+    return stream_new(unfold_next, unfold_clone, unfold_free, copy);
+}
+
+// Frees an unfold and its seed
+void unfold_free(struct stream *stream)
+{
+    struct stream_unfold *unfold = (struct stream_unfold*)stream->state;
+
+    if(unfold->seed)
+        value_delete(unfold->seed);
+    free(unfold);
+}
@@ -0,0 +1,89 @@
+/**
+ *  Copyright 2012, Robert Bieber
+ *
+ *  This file is part of col.
+ *
+ *  col is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  col is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with col.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+
+#ifndef STREAM_H
+#define STREAM_H
+
+/**
+ * Lazily generated sequences.  A stream produces its elements one at a
+ * time as they're pulled, so processing one never needs more memory than
+ * its generator does, however long it is.  map, reduce, head, tail, and
+ * length work on streams directly; any other function given a stream
+ * sees it materialized into an ordinary sequence first.
+ *
+ * Copies of a stream read from it independently, each from the position
+ * it was copied at.  Copies of a stream of lines share its input, and
+ * lines one copy has read are kept for the others until they catch up.
+ */
+
+struct value;
+struct function;
+
+struct stream
+{
+    // Number of values sharing the stream
+    int refs;
+    // Returns the next element, or NULL once the stream is exhausted
+    struct value *(*next)(struct stream *stream);
+    // Returns an independent copy, or NULL if the stream can't be copied
+    struct stream *(*clone)(struct stream *stream);
+    // Frees the generator's state
+    void (*free)(struct stream *stream);
+    void *state;
+};
+
+// Creates a stream around a generator, clone may be NULL
+struct stream *stream_new(struct value *(*next)(struct stream*),
+                          struct stream *(*clone)(struct stream*),
+                          void (*free)(struct stream*), void *state);
+// Wraps a stream in a new value, taking ownership of it
+struct value *stream_value(struct stream *stream);
+// Pulls the next element from a stream, returns NULL at its end
+struct value *stream_next(struct stream *stream);
+// Copies a stream, cloning it if possible and sharing it otherwise
+struct stream *stream_copy(struct stream *stream);
+// Releases a reference to a stream, freeing it with the last one
+void stream_release(struct stream *stream);
+// Pulls every element of a stream value into a sequence, consuming the
+// stream, or gives bottom if any element is bottom.  Any other value is
+// returned as it is.
+struct value *stream_materialize(struct value *value);
+
+// Streams the integers from start up to, but not including, end
+struct value *stream_range(int start, int end);
+// Streams the lines of a file, or of standard input if path is NULL.
+// Returns NULL if the file can't be opened.
+struct value *stream_lines(const char *path);
+// Streams the results of applying a function to each element of a
+// stream, taking ownership of the source
+struct value *stream_map(struct value *source, struct function *function);
+// Streams the elements of a stream for which a predicate is True, taking
+// ownership of the source.  If the predicate doesn't give a boolean for an
+// element, the stream fails: it ends with a bottom element, which makes
+// anything reading it whole bottom.
+struct value *stream_filter(struct value *source, struct function *predicate);
+// Streams the elements of unfold{ stop, emit, step } from a seed, taking
+// ownership of the seed.  A bottom element, or a bottom in place of the
+// test's boolean, is the last element of the stream.
+struct value *stream_unfold(struct value *seed, struct function *stop,
+                            struct function *emit, struct function *step);
+
+#endif // STREAM_H
@@ -18,24 +18,33 @@
  *
  **/
 
+
 #include <stdlib.h>
 #include <string.h>
 
 #include "symtable.h"
 #include "interpreter.h"
-#include "list.h"
+#include "optimizer.h"
+#include "hash.h"
 
-unsigned int hash(char *s);
+// Returns the slot holding name, or the empty slot where it would go
+struct symtable_entry *symtable_slot(struct symtable *table, char *name,
+                                     uint64_t hash);
+// Doubles the number of slots in a table
+void symtable_grow(struct symtable *table);
+// Copies a key into the table's key storage
+char *symtable_intern(struct symtable *table, char *name);
 
 // Creates a new symtable
 struct symtable *symtable_new()
 {
-    int i;
     struct symtable *retval = (struct symtable*)malloc(sizeof(struct symtable));
 
-    retval->size = SYMTABLE_SIZE;
-    for(i = 0; i < SYMTABLE_SIZE; i++)
-        retval->entries[i] = list_new();
+    retval->size = SYMTABLE_START_SIZE;
+    retval->count = 0;
+    retval->entries = (struct symtable_entry*)
+        calloc(SYMTABLE_START_SIZE, sizeof(struct symtable_entry));
+    retval->keys = NULL;
     
     return retval;
 }
@@ -44,89 +53,190 @@ struct symtable *symtable_new()
 void symtable_delete(struct symtable *table)
 {
     int i;
-    struct list *list = NULL;
-    struct cursor *c = NULL;
-    struct symtable_entry *entry = NULL;
+    struct symtable_chunk *chunk = NULL;
 
     if(!table)
         return;
 
-    for(i = 0; i < SYMTABLE_SIZE; i++)
+    for(i = 0; i < table->size; i++)
     {
-        list = table->entries[i];
-        for(c = cursor_new_front(list); cursor_valid(c); cursor_next(c))
-        {
-            entry = cursor_get(c);
-            free(entry->name);
-            function_delete(entry->data);
-            free(entry);
-        }
-        list_delete(list);
-        cursor_delete(c);
+        if(table->entries[i].name)
+            function_delete(table->entries[i].data);
     }
-    
+
+    while(table->keys)
+    {
+        chunk = table->keys;
+        table->keys = chunk->next;
+        free(chunk);
+    }
+
+    free(table->entries);
     free(table);
 }
 
-// Adds an entry to the table
+// Adds an entry to the table, replacing and deleting any existing
+// definition with the same name
 void symtable_add(struct symtable *table, char *name, struct function *data)
 {
-    struct symtable_entry *entry = 
-        (struct symtable_entry*)malloc(sizeof(struct symtable_entry));
-    struct list *list = table->entries[hash(name) % table->size];
+    uint64_t hash = hash_bytes(name, strlen(name));
+    struct symtable_entry *entry = symtable_slot(table, name, hash);
+
+    if(entry->name)
+    {
+        function_delete(entry->data);
+        entry->data = data;
+        return;
+    }
+
+    if((table->count + 1) * 100 > table->size * SYMTABLE_MAX_LOAD)
+    {
+        symtable_grow(table);
+        entry = symtable_slot(table, name, hash);
+    }
 
-    entry->name = strdup(name);
+    entry->hash = hash;
+    entry->name = symtable_intern(table, name);
     entry->data = data;
-    list_push(list, entry);
+    table->count++;
 }
 
 // Retrieves an entry from the table
 struct function *symtable_find(struct symtable *table, char *name)
 {
-    struct list *list = table->entries[hash(name) % table->size];
-    struct symtable_entry *entry = NULL;
-    struct cursor *c = NULL;
+    struct symtable_entry *entry =
+        symtable_slot(table, name, hash_bytes(name, strlen(name)));
 
-    for(c = cursor_new_front(list); cursor_valid(c); cursor_next(c))
-    {
-        entry = cursor_get(c);
-        
-        if(!entry)
-            break;
+    return entry->name ? entry->data : NULL;
+}
 
-        if(!strcmp(entry->name, name))
+// Removes an entry from the table, deleting its definition
+void symtable_remove(struct symtable *table, char *name)
+{
+    int mask = table->size - 1;
+    int hole, i, home;
+    struct symtable_entry *entry =
+        symtable_slot(table, name, hash_bytes(name, strlen(name)));
+
+    if(!entry->name)
+        return;
+
+    function_delete(entry->data);
+    entry->name = NULL;
+    table->count--;
+
+    // Shifting back any later entries in the run that would otherwise
+    // become unreachable across the hole.  The key's storage stays with
+    // the table until it's deleted.
+    hole = entry - table->entries;
+    for(i = (hole + 1) & mask; table->entries[i].name; i = (i + 1) & mask)
+    {
+        home = table->entries[i].hash & mask;
+        if(((i - home) & mask) >= ((i - hole) & mask))
         {
-            cursor_delete(c);
-            return entry->data;
+            table->entries[hole] = table->entries[i];
+            table->entries[i].name = NULL;
+            hole = i;
         }
     }
+}
+
+// Returns the entry after the given one, or the first entry if entry is
+// NULL, or NULL if there are no more entries
+struct symtable_entry *symtable_next(struct symtable *table,
+                                     struct symtable_entry *entry)
+{
+    struct symtable_entry *end = table->entries + table->size;
+
+    for(entry = entry ? entry + 1 : table->entries; entry < end; entry++)
+    {
+        if(entry->name)
+            return entry;
+    }
 
     return NULL;
 }
 
-// Removes an entry from the table
-void symtable_remove(struct symtable *table, char *name);
+// Links every function in the table against the table's own definitions
+void symtable_link(struct symtable *table)
+{
+    struct symtable_entry *entry = NULL;
+
+    for(entry = symtable_next(table, NULL)
+            ; entry
+            ; entry = symtable_next(table, entry))
+        function_link(entry->data, table);
+
+    optimize(table);
+}
+
+// Returns the slot holding name, or the empty slot where it would go
+struct symtable_entry *symtable_slot(struct symtable *table, char *name,
+                                     uint64_t hash)
+{
+    int mask = table->size - 1;
+    int i = hash & mask;
+    struct symtable_entry *entry = NULL;
+
+    // The load limit guarantees an empty slot to stop at
+    for(;; i = (i + 1) & mask)
+    {
+        entry = table->entries + i;
+        if(!entry->name
+           || (entry->hash == hash && !strcmp(entry->name, name)))
+            return entry;
+    }
+}
 
-unsigned int hash(char *s)
+// Doubles the number of slots in a table
+void symtable_grow(struct symtable *table)
 {
-    int i = 0;
-    char *c = s;
-    unsigned int total = 0;
-    char buf[sizeof(unsigned int) / sizeof(char)];
+    int i, j;
+    int old_size = table->size;
+    int mask = old_size * 2 - 1;
+    struct symtable_entry *old = table->entries;
+
+    table->size = old_size * 2;
+    table->entries = (struct symtable_entry*)
+        calloc(table->size, sizeof(struct symtable_entry));
 
-    for(i = 0; i < sizeof(unsigned int) / sizeof(char); i++)
-        buf[i] = 0;
+    // Keys are all distinct, so each just takes the first free slot
+    for(i = 0; i < old_size; i++)
+    {
+        if(!old[i].name)
+            continue;
+
+        for(j = old[i].hash & mask; table->entries[j].name; j = (j + 1) & mask)
+            ;
+        table->entries[j] = old[i];
+    }
+
+    free(old);
+}
+
+// Copies a key into the table's key storage
+char *symtable_intern(struct symtable *table, char *name)
+{
+    size_t length = strlen(name) + 1;
+    size_t size = SYMTABLE_CHUNK_SIZE;
+    struct symtable_chunk *chunk = table->keys;
+    char *key = NULL;
 
-    for(c = s, i = 0; *c != '\0'; c++, i++)
+    if(!chunk || chunk->size - chunk->used < length)
     {
-        buf[i % (sizeof(unsigned int) / sizeof(char))] = *c;
-        if(i % (sizeof(unsigned int) / sizeof(char))
-           == (sizeof(unsigned int) / sizeof(char)) - 1)
-            total += *((unsigned int*)buf);
+        if(length > size)
+            size = length;
+
+        chunk = (struct symtable_chunk*)
+            malloc(sizeof(struct symtable_chunk) + size);
+        chunk->next = table->keys;
+        chunk->used = 0;
+        chunk->size = size;
+        table->keys = chunk;
     }
 
-    if(i % (sizeof(unsigned int) / sizeof(char)) != 0)
-        total += *((unsigned int*)buf);
-        
-    return total;
+    key = (char*)(chunk + 1) + chunk->used;
+    memcpy(key, name, length);
+    chunk->used += length;
+    return key;
 }
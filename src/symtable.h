@@ -18,37 +18,65 @@
  *
  **/
 
+
 #ifndef SYMTABLE_H
 #define SYMTABLE_H
 
-#define SYMTABLE_SIZE 1024
+#include <stddef.h>
+#include <stdint.h>
+
+#define SYMTABLE_START_SIZE 64   // Initial number of slots, a power of two
+#define SYMTABLE_MAX_LOAD 75     // Percentage of slots used before growing
+#define SYMTABLE_CHUNK_SIZE 4096 // Minimum size of a key storage chunk
 
-struct list;
 struct function;
 
-// symtables are stored as hash-tables with linked-list chaining for collisions
-struct symtable
+// Block of storage for interned key strings
+struct symtable_chunk
 {
-    int size;
-    struct list *entries[SYMTABLE_SIZE];
+    struct symtable_chunk *next;
+    size_t used;
+    size_t size;
 };
 
+// An empty slot has a NULL name
 struct symtable_entry
 {
+    uint64_t hash;
     char *name;
     struct function *data;
 };
 
+// symtables are stored as open-addressed hash tables with linear probing,
+// doubling in size whenever they pass the maximum load.  Each key is
+// interned in storage owned by the table.
+struct symtable
+{
+    int size;
+    int count;
+    struct symtable_entry *entries;
+    struct symtable_chunk *keys;
+};
+
 // Creates a new symtable
 struct symtable *symtable_new();
 // Deletes a symtable
 void symtable_delete();
 
-// Adds an entry to the table
+// Adds an entry to the table, replacing and deleting any existing
+// definition with the same name
 void symtable_add(struct symtable *table, char *name, struct function *data);
 // Retrieves an entry from the table
 struct function *symtable_find(struct symtable *table, char *name);
-// Removes an entry from the table
+// Removes an entry from the table, deleting its definition
 void symtable_remove(struct symtable *table, char *name);
 
+// Returns the entry after the given one, or the first entry if entry is
+// NULL, or NULL if there are no more entries
+struct symtable_entry *symtable_next(struct symtable *table,
+                                     struct symtable_entry *entry);
+
+// Links every function in the table against the table's own definitions
+void symtable_link(struct symtable *table);
+
 #endif // SYMTABLE_H
@@ -71,6 +71,89 @@ def writeFunctionHeader(filename, data):
     fout.write("\n")
     fout.close()
 
+# 32-bit FNV-1a, which gives each built-in name its stable ID.  Must match
+# hash_bytes32 in src/hash.c
+def nameId(name):
+    h = 2166136261
+    for c in name.encode():
+        h ^= c
+        h = (h * 16777619) & 0xffffffff
+    return h
+
+# Picks a slot for an ID with a displacement.  Must match builtin_slot in
+# src/interpreter.c
+def slotHash(id, displacement, size):
+    h = ((id ^ displacement) * 2654435761) & 0xffffffff
+    h ^= h >> 16
+    return h % size
+
+# Builds a minimal perfect hash of built-in IDs by hash and displace: IDs
+# are split into buckets by id % size, then each bucket, largest first,
+# gets the first displacement that moves all of its IDs into free slots.
+# Buckets of one are placed directly, stored as -(slot + 1)
+def buildHash(entries):
+    size = len(entries)
+    buckets = [[] for i in range(size)]
+    displacements = [0] * size
+    slots = [None] * size
+
+    for entry in entries:
+        buckets[entry[3] % size].append(entry)
+    order = sorted(range(size), key = lambda b: -len(buckets[b]))
+
+    for b in order:
+        bucket = buckets[b]
+        if len(bucket) <= 1:
+            break
+        displacement = 1
+        while True:
+            taken = [slotHash(e[3], displacement, size) for e in bucket]
+            if len(set(taken)) == len(taken) and \
+               all(slots[t] is None for t in taken):
+                break
+            displacement += 1
+        displacements[b] = displacement
+        for e, t in zip(bucket, taken):
+            slots[t] = e
+
+    free = [i for i in range(size) if slots[i] is None]
+    for b in order:
+        if len(buckets[b]) == 1:
+            slot = free.pop()
+            slots[slot] = buckets[b][0]
+            displacements[b] = -(slot + 1)
+
+    return (slots, displacements)
+
+# Writes the headers for the perfect hash table of built-in names
+def writeHashHeaders(tableFile, displacementFile, primitives, forms):
+    entries = []
+    for i, entry in enumerate(primitives):
+        entries.append((entry[0], 'PRIMITIVE', i, nameId(entry[0])))
+    for i, entry in enumerate(forms):
+        entries.append((entry[0], 'FORM', i, nameId(entry[0])))
+
+    ids = {}
+    for entry in entries:
+        if entry[3] in ids:
+            raise Exception('Built-in IDs of ' + ids[entry[3]] + ' and ' +
+                            entry[0] + ' collide, rename one of them')
+        ids[entry[3]] = entry[0]
+
+    (slots, displacements) = buildHash(entries)
+
+    fout = open(tableFile, 'w')
+    fout.write(",\n".join('{"%s", %d, %s, %d, 0x%08xu}' %
+                          (e[0], len(e[0]), e[1], e[2], e[3])
+                          for e in slots))
+    fout.write("\n")
+    fout.close()
+
+    fout = open(displacementFile, 'w')
+    fout.write(",\n".join(str(d) for d in displacements))
+    fout.write("\n")
+    fout.close()
+
 regex = re.compile(r"struct\s+value\s*\*(.*)\(")
 
 # Reading the input files and sorting the function lists
@@ -88,4 +171,6 @@ writeNameHeader('src/gen/primitive_names.h', primitives)
 writeFunctionHeader('src/gen/primitive_defs.h', primitives)
 writeNameHeader('src/gen/form_names.h', forms)
 writeFunctionHeader('src/gen/form_defs.h', forms)
+writeHashHeaders('src/gen/builtin_table.h', 'src/gen/builtin_displacements.h',
+                 primitives, forms)
 